@@ -0,0 +1,130 @@
+// Offline benchmark for the analysis and render paths: feeds synthetic PCM through SpectrumAnalyzer and
+// renders frames into image surfaces, reporting time and heap allocations per fragment/frame.
+//
+//   novic_bench [iterations]
+#include "novic/constants.h"
+#include "novic/spectrum_analyzer.h"
+#include "novic/render.h"
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <new>
+#include <random>
+#include <string>
+#include <vector>
+
+static std::atomic<size_t> allocations{0};
+
+#if defined(__GLIBC__)
+// Interpose the malloc family so allocations made inside cairo/pixman are counted as well as C++ ones
+extern "C" {
+void* __libc_malloc(size_t); void* __libc_calloc(size_t, size_t); void* __libc_realloc(void*, size_t);
+void* malloc(size_t n) { allocations.fetch_add(1, std::memory_order_relaxed); return __libc_malloc(n); }
+void* calloc(size_t n, size_t s) { allocations.fetch_add(1, std::memory_order_relaxed); return __libc_calloc(n, s); }
+void* realloc(void* p, size_t n) { allocations.fetch_add(1, std::memory_order_relaxed); return __libc_realloc(p, n); }
+}
+#else
+void* operator new(size_t n) { allocations.fetch_add(1, std::memory_order_relaxed); if (void* p = std::malloc(n ? n : 1)) return p; throw std::bad_alloc(); }
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+#endif
+
+constexpr int RATE = 44100, CHANNELS = 2, FRAGMENT_FRAMES = 512;
+
+struct Result { double ns; double allocs; };
+
+static Result measure(int iterations, const std::function<void(int)>& body) {
+    for (int i = 0; i < std::min(iterations, 16); i++) body(i);
+    size_t a0 = allocations.load();
+    auto t0 = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; i++) body(i);
+    auto t1 = std::chrono::steady_clock::now();
+    size_t a1 = allocations.load();
+    return {std::chrono::duration<double, std::nano>(t1 - t0).count() / iterations, (double)(a1 - a0) / iterations};
+}
+
+// Interleaved stereo fragments, generated up front so the timed loop only sees the analyzer
+static std::vector<float> make_signal(const std::string& kind, int fragments) {
+    std::vector<float> pcm((size_t)fragments * FRAGMENT_FRAMES * CHANNELS, 0.0f);
+    size_t frames = pcm.size() / CHANNELS; std::mt19937 rng(1234); std::uniform_real_distribution<float> noise(-0.5f, 0.5f);
+    double phase = 0;
+    for (size_t i = 0; i < frames; i++) {
+        float s = 0;
+        if (kind == "sweep") { double f = 20.0 * std::pow(1000.0, (double)i / frames); phase += 2 * M_PI * f / RATE; s = 0.5f * std::sin(phase); }
+        else if (kind == "noise") s = noise(rng);
+        for (int c = 0; c < CHANNELS; c++) pcm[i * CHANNELS + c] = s;
+    }
+    return pcm;
+}
+
+// The per-frame paths BarSprite and BackgroundCache replaced, kept as the baseline for the "arcs" cases:
+// every bar is four arcs filled on its own, and the background is tessellated on every draw
+static void draw_arc_bars(const Cairo::RefPtr<Cairo::Context>& cr, const std::vector<float>& levels, double bw, double bs, double sx, double mh, double cy) {
+    for (size_t i = 0; i < levels.size(); i++) {
+        double bh = bw + (mh - bw) * levels[i], x = sx + i * (bw + bs), y = cy - bh / 2, rad = bw / 2;
+        cr->arc(x + rad, y + rad, rad, M_PI, 3 * M_PI / 2); cr->arc(x + bw - rad, y + rad, rad, 3 * M_PI / 2, 0);
+        cr->arc(x + bw - rad, y + bh - rad, rad, 0, M_PI / 2); cr->arc(x + rad, y + bh - rad, rad, M_PI / 2, M_PI);
+        cr->close_path(); cr->set_source_rgb(1, 1, 1); cr->fill();
+    }
+}
+
+static void draw_arc_background(const Cairo::RefPtr<Cairo::Context>& cr, double w, double h) {
+    double r = 25.0;
+    cr->move_to(0, 0); cr->line_to(w, 0); cr->line_to(w, h - r);
+    cr->arc(w - r, h - r, r, 0, M_PI / 2); cr->arc(r, h - r, r, M_PI / 2, M_PI); cr->close_path();
+    cr->set_source_rgba(0.043, 0.047, 0.047, 0.98); cr->fill();
+}
+
+int main(int argc, char* argv[]) {
+    int iterations = argc > 1 ? std::max(1, std::atoi(argv[1])) : 2000;
+    std::printf("%-10s %-22s %14s %14s\n", "stage", "case", "ns/iter", "allocs/iter");
+
+    SpectrumAnalyzer analyzer; std::vector<float> levels(analyzer.bar_count());
+    std::vector<std::vector<float>> frames;
+    for (const char* kind : {"sweep", "noise", "silence"}) {
+        auto pcm = make_signal(kind, iterations);
+        auto r = measure(iterations, [&](int i) {
+            analyzer.push(pcm.data() + (size_t)i * FRAGMENT_FRAMES * CHANNELS, FRAGMENT_FRAMES, CHANNELS);
+            analyzer.analyze(levels.data());
+        });
+        std::printf("%-10s %-22s %14.0f %14.2f\n", "analyzer", (std::string(kind) + " (512 frames)").c_str(), r.ns, r.allocs);
+        // The sweep's levels drive the render benchmark so bars move from frame to frame
+        for (int i = 0; kind == std::string("sweep") && i < std::min(iterations, 256); i++) {
+            analyzer.push(pcm.data() + (size_t)i * FRAGMENT_FRAMES * CHANNELS, FRAGMENT_FRAMES, CHANNELS);
+            analyzer.analyze(levels.data()); frames.push_back(levels);
+        }
+    }
+
+    // Offscreen frames laid out like the window: background, bars and (expanded) progress bar, drawn once with the
+    // cached sprites and once with the arc paths they replaced
+    for (bool arcs : {false, true}) {
+        auto surface = Cairo::ImageSurface::create(Cairo::FORMAT_ARGB32, COLLAPSED_WIDTH, COLLAPSED_HEIGHT); auto cr = Cairo::Context::create(surface);
+        BackgroundCache background; BarSprite bars;
+        auto r = measure(iterations, [&](int i) {
+            auto& levels = frames[i % frames.size()]; int n = levels.size();
+            if (arcs) draw_arc_background(cr, COLLAPSED_WIDTH, COLLAPSED_HEIGHT); else background.draw(cr, COLLAPSED_WIDTH, COLLAPSED_HEIGHT, 1);
+            cr->save(); cr->translate(COLLAPSED_WIDTH - 20 - 120, 12);
+            if (arcs) draw_arc_bars(cr, levels, 3, 3, 120 - (n * 3 + (n - 1) * 3) - 4, 36 * 0.9, 36 / 2.0); else draw_collapsed_bars(cr, bars, levels, 120, 36, 1);
+            cr->restore();
+        });
+        std::printf("%-10s %-22s %14.0f %14.2f\n", "render", arcs ? "collapsed 400x60 arcs" : "collapsed 400x60", r.ns, r.allocs);
+    }
+    for (bool arcs : {false, true}) {
+        auto surface = Cairo::ImageSurface::create(Cairo::FORMAT_ARGB32, EXPANDED_WIDTH, EXPANDED_HEIGHT); auto cr = Cairo::Context::create(surface);
+        BackgroundCache background; BarSprite bars;
+        auto r = measure(iterations, [&](int i) {
+            auto& levels = frames[i % frames.size()]; int n = levels.size();
+            if (arcs) draw_arc_background(cr, EXPANDED_WIDTH, EXPANDED_HEIGHT); else background.draw(cr, EXPANDED_WIDTH, EXPANDED_HEIGHT, 1);
+            cr->save(); cr->translate(EXPANDED_WIDTH - 25 - 80, 25);
+            if (arcs) draw_arc_bars(cr, levels, 4, 4, (80 - (n * 4 + (n - 1) * 4)) / 2.0, 80 * 0.85, 80 / 2.0); else draw_expanded_bars(cr, bars, levels, 80, 80, 1);
+            cr->restore();
+            cr->save(); cr->translate(65, 150);
+            draw_progress(cr, EXPANDED_WIDTH - 130, 6, (double)i / iterations); cr->restore();
+        });
+        std::printf("%-10s %-22s %14.0f %14.2f\n", "render", arcs ? "expanded 620x240 arcs" : "expanded 620x240", r.ns, r.allocs);
+    }
+    return 0;
+}
@@ -0,0 +1,57 @@
+// Stand-in for UPower on the session bus, for exercising the quality governor's battery handling without
+// unplugging anything. Run Novic with NOVIC_UPOWER_BUS=session, then type "on" or "off" to switch power source.
+//
+//   novic_fake_upower [on|off]
+#include "novic/dbus_properties.h"
+#include <giomm.h>
+#include <iostream>
+#include <string>
+
+namespace {
+
+constexpr const char* UPOWER_XML =
+    "<node><interface name='org.freedesktop.UPower'>"
+    "<property name='OnBattery' type='b' access='read'/>"
+    "</interface></node>";
+
+class FakeUPower {
+public:
+    explicit FakeUPower(bool battery) : on_battery(battery),
+        vtable(Gio::DBus::InterfaceVTable::SlotInterfaceMethodCall(), sigc::mem_fun(*this, &FakeUPower::on_get_property)) {}
+    void on_bus_acquired(const Glib::RefPtr<Gio::DBus::Connection>& c, const Glib::ustring&) {
+        conn = c;
+        conn->register_object("/org/freedesktop/UPower", Gio::DBus::NodeInfo::create_for_xml(UPOWER_XML)->lookup_interface("org.freedesktop.UPower"), vtable);
+    }
+    bool on_input(Glib::IOCondition) {
+        // Keeps serving the current state once stdin closes
+        std::string line; if (!std::getline(std::cin, line)) return false;
+        if (line == "on" || line == "off") set(line == "on");
+        else std::cerr << "type \"on\" or \"off\"\n";
+        return true;
+    }
+private:
+    bool on_battery; Glib::RefPtr<Gio::DBus::Connection> conn; Gio::DBus::InterfaceVTable vtable;
+    void set(bool battery) {
+        on_battery = battery; std::cout << "OnBattery = " << (battery ? "true" : "false") << std::endl;
+        if (!conn) return;
+        emit_properties_changed(conn, "/org/freedesktop/UPower", "org.freedesktop.UPower", {{"OnBattery", Glib::Variant<bool>::create(battery)}});
+    }
+    void on_get_property(Glib::VariantBase& property, const Glib::RefPtr<Gio::DBus::Connection>&, const Glib::ustring&, const Glib::ustring&,
+                         const Glib::ustring&, const Glib::ustring& name) {
+        if (name == "OnBattery") property = Glib::Variant<bool>::create(on_battery);
+    }
+};
+
+}
+
+int main(int argc, char* argv[]) {
+    Gio::init();
+    FakeUPower upower(argc > 1 && std::string(argv[1]) == "on");
+    auto loop = Glib::MainLoop::create();
+    Gio::DBus::own_name(Gio::DBus::BUS_TYPE_SESSION, "org.freedesktop.UPower", sigc::mem_fun(upower, &FakeUPower::on_bus_acquired),
+        Gio::DBus::SlotNameAcquired(), [loop](const Glib::RefPtr<Gio::DBus::Connection>&, const Glib::ustring&) {
+            std::cerr << "novic_fake_upower: org.freedesktop.UPower is already owned on the session bus\n"; loop->quit(); });
+    Glib::signal_io().connect(sigc::mem_fun(upower, &FakeUPower::on_input), 0, Glib::IO_IN | Glib::IO_HUP);
+    loop->run();
+    return 0;
+}
@@ -0,0 +1,221 @@
+// Replays a session recorded with NOVIC_RECORD=path without a display or sound server: a private
+// dbus-daemon hosts stand-in MPRIS players that re-emit the recorded traffic to a real MediaMonitor,
+// recorded PCM is fed to AudioVisualizer in place of PulseAudio, and frames are rendered offscreen at
+// 60 Hz. Reports property-change-to-redraw latency and CPU time per minute of playback.
+//
+//   novic_replay TRACE [speed]
+#include "novic/constants.h"
+#include "novic/audio_visualizer.h"
+#include "novic/dbus_properties.h"
+#include "novic/media_monitor.h"
+#include "novic/render.h"
+#include "novic/stats.h"
+#include "novic/trace.h"
+#include <giomm.h>
+#include <sys/resource.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
+#include <typeinfo>
+#include <vector>
+
+namespace {
+
+using PropMap = DBusPropertyMap;
+
+constexpr const char* PLAYER_IFACE = "org.mpris.MediaPlayer2.Player";
+constexpr const char* PLAYER_XML =
+    "<node><interface name='org.mpris.MediaPlayer2.Player'>"
+    "<method name='PlayPause'/><method name='Play'/><method name='Pause'/><method name='Stop'/><method name='Next'/><method name='Previous'/>"
+    "<signal name='Seeked'><arg name='Position' type='x'/></signal>"
+    "<property name='PlaybackStatus' type='s' access='read'/><property name='LoopStatus' type='s' access='read'/>"
+    "<property name='Rate' type='d' access='read'/><property name='Shuffle' type='b' access='read'/>"
+    "<property name='Metadata' type='a{sv}' access='read'/><property name='Volume' type='d' access='read'/>"
+    "<property name='Position' type='x' access='read'/><property name='MinimumRate' type='d' access='read'/>"
+    "<property name='MaximumRate' type='d' access='read'/><property name='CanGoNext' type='b' access='read'/>"
+    "<property name='CanGoPrevious' type='b' access='read'/><property name='CanPlay' type='b' access='read'/>"
+    "<property name='CanPause' type='b' access='read'/><property name='CanSeek' type='b' access='read'/>"
+    "<property name='CanControl' type='b' access='read'/>"
+    "</interface></node>";
+
+double cpu_seconds() {
+    rusage u; getrusage(RUSAGE_SELF, &u);
+    return u.ru_utime.tv_sec + u.ru_stime.tv_sec + (u.ru_utime.tv_usec + u.ru_stime.tv_usec) / 1e6;
+}
+
+// Analyse at the recorded format so band edges match the session that was captured
+CaptureConfig recorded_format(const std::vector<TraceRecord>& records) {
+    CaptureConfig c;
+    for (auto& r : records) if (r.kind == TraceKind::Pcm && r.pcm_rate() && r.pcm_channels()) { c.rate = r.pcm_rate(); c.channels = r.pcm_channels(); break; }
+    return c;
+}
+
+double percentile(std::vector<double> v, double p) {
+    if (v.empty()) return 0; std::sort(v.begin(), v.end());
+    return v[std::min(v.size() - 1, (size_t)(p * v.size()))];
+}
+
+// One recorded player, served from its own bus connection so each bus name has a distinct owner
+class StandInPlayer {
+public:
+    StandInPlayer(const std::string& address, const Glib::ustring& name, const PropMap& initial) : props(initial),
+        vtable(sigc::mem_fun(*this, &StandInPlayer::on_method_call), sigc::mem_fun(*this, &StandInPlayer::on_get_property)) {
+        conn = Gio::DBus::Connection::create_for_address_sync(address,
+            Gio::DBus::CONNECTION_FLAGS_AUTHENTICATION_CLIENT | Gio::DBus::CONNECTION_FLAGS_MESSAGE_BUS_CONNECTION);
+        auto node = Gio::DBus::NodeInfo::create_for_xml(PLAYER_XML);
+        conn->register_object("/org/mpris/MediaPlayer2", node->lookup_interface(PLAYER_IFACE), vtable);
+        conn->call_sync("/org/freedesktop/DBus", "org.freedesktop.DBus", "RequestName",
+            Glib::VariantContainerBase::create_tuple({Glib::Variant<Glib::ustring>::create(name), Glib::Variant<guint32>::create(0)}), "org.freedesktop.DBus");
+    }
+    ~StandInPlayer() { try { conn->close_sync(); } catch(...) {} }
+    void properties_changed(const PropMap& changed) {
+        for (auto& [k, v] : changed) props[k] = v;
+        emit_properties_changed(conn, "/org/mpris/MediaPlayer2", PLAYER_IFACE, changed);
+    }
+    void seeked(gint64 position) {
+        props["Position"] = Glib::Variant<gint64>::create(position);
+        conn->emit_signal("/org/mpris/MediaPlayer2", PLAYER_IFACE, "Seeked", {}, Glib::VariantContainerBase::create_tuple(Glib::Variant<gint64>::create(position)));
+    }
+private:
+    Glib::RefPtr<Gio::DBus::Connection> conn; PropMap props; Gio::DBus::InterfaceVTable vtable;
+    // Commands are accepted and ignored; the trace already holds whatever the real player did next
+    void on_method_call(const Glib::RefPtr<Gio::DBus::Connection>&, const Glib::ustring&, const Glib::ustring&, const Glib::ustring&,
+                        const Glib::ustring&, const Glib::VariantContainerBase&, const Glib::RefPtr<Gio::DBus::MethodInvocation>& invocation) {
+        invocation->return_value(Glib::VariantContainerBase());
+    }
+    void on_get_property(Glib::VariantBase& property, const Glib::RefPtr<Gio::DBus::Connection>&, const Glib::ustring&, const Glib::ustring&,
+                         const Glib::ustring&, const Glib::ustring& name) {
+        auto it = props.find(name); if (it != props.end()) property = it->second;
+    }
+};
+
+class Replay : public sigc::trackable {
+public:
+    Replay(std::vector<TraceRecord> recs, double speed, std::string address) : records(std::move(recs)), speed(speed), address(std::move(address)) {
+        monitor.signal_metadata_changed().connect(sigc::mem_fun(*this, &Replay::on_media_changed));
+        monitor.signal_status_changed().connect(sigc::mem_fun(*this, &Replay::on_status_changed));
+        monitor.signal_position_changed().connect(sigc::mem_fun(*this, &Replay::on_media_changed));
+        surface = Cairo::ImageSurface::create(Cairo::FORMAT_ARGB32, EXPANDED_WIDTH, EXPANDED_HEIGHT);
+    }
+    int run() {
+        auto loop = Glib::MainLoop::create();
+        start = g_get_monotonic_time(); double cpu0 = cpu_seconds();
+        std::thread pcm(&Replay::feed_pcm, this);
+        Glib::signal_timeout().connect(sigc::mem_fun(*this, &Replay::on_frame), 16);
+        Glib::signal_idle().connect_once(sigc::mem_fun(*this, &Replay::dispatch));
+        int64_t end = records.empty() ? 0 : records.back().time;
+        Glib::signal_timeout().connect_once([loop]() { loop->quit(); }, (unsigned)(end / 1000 / speed) + 1000);
+        loop->run();
+        stop = true; pcm.join();
+        double wall = (g_get_monotonic_time() - start) / 1e6, cpu = cpu_seconds() - cpu0, minutes = end / 60e6;
+        std::printf("%-18s %zu (%zu dbus, %zu pcm, %zu pcm skipped)\n", "records", records.size(), dbus_records, pcm_fed.load() + pcm_skipped.load(), pcm_skipped.load());
+        std::printf("%-18s %.1f s recorded, %.1f s wall at %.2fx\n", "duration", end / 1e6, wall, speed);
+        std::printf("%-18s %zu, %.1f us avg render\n", "frames", frames, frames ? render_us / frames : 0.0);
+        std::printf("%-18s %zu samples, p50 %.2f ms, p95 %.2f ms, max %.2f ms\n", "change->redraw", latencies.size(),
+            percentile(latencies, 0.5), percentile(latencies, 0.95), latencies.empty() ? 0.0 : *std::max_element(latencies.begin(), latencies.end()));
+        std::printf("%-18s %.2f s total, %.2f s per minute of playback (%.1f%% of one core)\n", "cpu", cpu,
+            minutes > 0 ? cpu / minutes : 0.0, wall > 0 ? 100.0 * cpu / wall : 0.0);
+        std::printf("\n%s", Stats::get().format().c_str());
+        return 0;
+    }
+private:
+    std::vector<TraceRecord> records; double speed; std::string address;
+    MediaMonitor monitor; AudioVisualizer visualizer{NUM_BARS, recorded_format(records), false};
+    std::map<Glib::ustring, std::unique_ptr<StandInPlayer>> players;
+    Cairo::RefPtr<Cairo::ImageSurface> surface; BackgroundCache background; BarSprite bars;
+    MediaMonitor::MediaInfo info; gint64 start = 0, last_frame = 0; size_t next = 0, dbus_records = 0, frames = 0; double render_us = 0;
+    std::deque<gint64> emitted, awaiting; std::vector<double> latencies;
+    std::atomic<bool> stop{false}; std::atomic<size_t> pcm_fed{0}, pcm_skipped{0};
+
+    gint64 due(const TraceRecord& r) const { return start + (gint64)(r.time / speed); }
+
+    // Emits every D-Bus record that is due, then sleeps until the next one
+    void dispatch() {
+        gint64 now = g_get_monotonic_time();
+        for (; next < records.size() && due(records[next]) <= now; next++) {
+            auto& r = records[next]; if (r.kind == TraceKind::Pcm) continue;
+            dbus_records++;
+            // A record whose payload does not have its kind's type is skipped like one the bus rejected
+            try { replay(r, now); }
+            catch (const Glib::Error& e) { std::fprintf(stderr, "novic_replay: %s\n", e.what().c_str()); }
+            catch (const std::bad_cast&) { std::fprintf(stderr, "novic_replay: skipping malformed record at %.3f s\n", r.time / 1e6); }
+        }
+        while (next < records.size() && records[next].kind == TraceKind::Pcm) next++;
+        if (next < records.size()) Glib::signal_timeout().connect_once(sigc::mem_fun(*this, &Replay::dispatch), std::max<gint64>(0, (due(records[next]) - now) / 1000));
+    }
+
+    void replay(const TraceRecord& r, gint64 now) {
+        auto v = r.variant(); Glib::Variant<Glib::ustring> name; v.get_child(name, 0);
+        auto it = players.find(name.get());
+        if (r.kind == TraceKind::PlayerAppeared) {
+            Glib::Variant<PropMap> props; v.get_child(props, 1);
+            players[name.get()] = std::make_unique<StandInPlayer>(address, name.get(), props.get());
+        } else if (r.kind == TraceKind::PlayerVanished) {
+            if (it != players.end()) players.erase(it);
+        } else if (it == players.end()) {
+            return;
+        } else if (r.kind == TraceKind::PropertiesChanged) {
+            Glib::Variant<PropMap> changed; v.get_child(changed, 1); auto m = changed.get();
+            it->second->properties_changed(m);
+            // Only properties the monitor reports on can cause a redraw
+            for (auto* k : {"PlaybackStatus", "Metadata", "Rate", "Position"}) if (m.count(k)) { emitted.push_back(now); break; }
+        } else if (r.kind == TraceKind::Seeked) {
+            Glib::Variant<gint64> pos; v.get_child(pos, 1); it->second->seeked(pos.get()); emitted.push_back(now);
+        }
+    }
+
+    // Stands in for the PulseAudio read callback: one producer, paced to the recorded timestamps
+    void feed_pcm() {
+        for (auto& r : records) {
+            if (stop) return;
+            if (r.kind != TraceKind::Pcm) continue;
+            if (r.pcm_rate() != visualizer.capture_config().rate || !r.pcm_channels()) { pcm_skipped++; continue; }
+            gint64 wait = due(r) - g_get_monotonic_time();
+            if (wait > 0) std::this_thread::sleep_for(std::chrono::microseconds(wait));
+            visualizer.feed(r.pcm_samples(), r.pcm_frames(), r.pcm_channels()); pcm_fed++;
+        }
+    }
+
+    void on_media_changed(MediaMonitor::MediaInfo i) { info = i; awaiting.insert(awaiting.end(), emitted.begin(), emitted.end()); emitted.clear(); }
+    void on_status_changed(MediaMonitor::MediaInfo i) { visualizer.set_playing(i.is_playing); on_media_changed(i); }
+
+    // Renders what the expanded window shows; a change counts as on screen once the frame after it completes
+    bool on_frame() {
+        gint64 now = g_get_monotonic_time(); double dt = last_frame ? (now - last_frame) / 1000.0 : 16.67; last_frame = now;
+        visualizer.update(dt);
+        auto cr = Cairo::Context::create(surface);
+        background.draw(cr, EXPANDED_WIDTH, EXPANDED_HEIGHT, 1);
+        draw_expanded_bars(cr, bars, visualizer.get_levels(), 80, 80, 1);
+        double progress = info.length > 0 ? (double)info.position_at(now) / info.length : 0.0;
+        draw_progress(cr, EXPANDED_WIDTH - 40, 6, progress);
+        surface->flush();
+        gint64 done = g_get_monotonic_time(); render_us += done - now; frames++;
+        for (auto t : awaiting) latencies.push_back((done - t) / 1000.0);
+        awaiting.clear();
+        return true;
+    }
+};
+
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) { std::fprintf(stderr, "usage: novic_replay TRACE [speed]\n"); return 2; }
+    double speed = argc > 2 ? std::max(0.01, std::atof(argv[2])) : 1.0;
+    std::vector<TraceRecord> records;
+    if (!read_trace(argv[1], records)) { std::fprintf(stderr, "novic_replay: %s is not a novic trace\n", argv[1]); return 1; }
+    if (Glib::find_program_in_path("dbus-daemon").empty()) { std::fprintf(stderr, "novic_replay: dbus-daemon not found\n"); return 1; }
+    Gio::init();
+    // Points DBUS_SESSION_BUS_ADDRESS at a private daemon before MediaMonitor connects
+    GTestDBus* bus = g_test_dbus_new(G_TEST_DBUS_NONE); g_test_dbus_up(bus);
+    int rc;
+    { Replay replay(std::move(records), speed, g_test_dbus_get_bus_address(bus)); rc = replay.run(); }
+    g_test_dbus_down(bus); g_object_unref(bus);
+    return rc;
+}
@@ -0,0 +1,42 @@
+#pragma once
+#include <gtkmm.h>
+#include <condition_variable>
+#include <deque>
+#include <list>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// Album art loaded on a worker thread, persisted under $XDG_CACHE_HOME/novic/art (remote art only, trimmed to
+// the most recently used DISK_CAPACITY files) and kept in memory as pre-clipped surfaces at album-art and icon size
+class ArtCache {
+public:
+    struct Art { Cairo::RefPtr<Cairo::ImageSurface> large, small; };
+    ArtCache();
+    ~ArtCache();
+    // Returns the cached art for url (and marks it recently used), or nullptr on a miss
+    const Art* lookup(const std::string& url);
+    // Queues url for loading on the worker thread; signal_ready() fires on the UI thread when done, also when
+    // loading failed, in which case lookup() stays a miss so a later request tries again
+    void request(const std::string& url);
+    sigc::signal<void(std::string)> signal_ready() { return sig; }
+private:
+    static constexpr size_t CAPACITY = 32, DISK_CAPACITY = 256, PRUNE_EVERY = 32;
+    struct Loaded { std::string url; Glib::RefPtr<Gdk::Pixbuf> large, small; };
+    std::string cache_dir; Glib::RefPtr<Gio::Cancellable> cancel;
+    std::list<std::pair<std::string, Art>> lru; std::unordered_map<std::string, decltype(lru)::iterator> index;
+    std::set<std::string> pending; sigc::signal<void(std::string)> sig;
+    std::mutex mtx; std::condition_variable cv; std::deque<std::string> jobs; std::vector<Loaded> loaded; bool stopping = false;
+    size_t saved = 0; // worker thread only
+    Glib::Dispatcher dispatcher; std::thread worker;
+
+    void run();
+    Loaded load(const std::string& url);
+    void prune_disk();
+    static Glib::RefPtr<Gdk::Pixbuf> decode_square(const Glib::RefPtr<Gio::InputStream>& in, int size, const Glib::RefPtr<Gio::Cancellable>& cancel);
+    void on_loaded();
+    static Cairo::RefPtr<Cairo::ImageSurface> clipped(const Glib::RefPtr<Gdk::Pixbuf>& pb, double r);
+};
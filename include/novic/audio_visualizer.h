@@ -0,0 +1,71 @@
+#pragma once
+#include "novic/constants.h"
+#include "novic/spectrum_analyzer.h"
+#include "novic/stats.h"
+#include "novic/trace.h"
+#include "novic/triple_buffer.h"
+#include <pulse/pulseaudio.h>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <string>
+#include <vector>
+
+class SpectrumRingWriter;
+
+// Format requested for the monitor stream; the server resamples and downmixes, so a small display
+// only pays for the samples it can show
+struct CaptureConfig {
+    uint32_t rate = 24000; uint8_t channels = 1;
+    // One fragment per display frame, or more often if the latency target is tighter than a frame
+    double refresh_hz = 60.0, latency_ms = 20.0;
+    uint32_t fragment_bytes() const;
+};
+
+// Captures the default sink's monitor on a PulseAudio thread and exposes smoothed spectrum levels to the UI
+class AudioVisualizer {
+public:
+    // Without capture no PulseAudio connection is made and samples arrive through feed() instead;
+    // with a trace every captured fragment is recorded before analysis, and with a ring every analysed
+    // frame is published to it straight from the capture thread. Both must outlive the visualizer.
+    explicit AudioVisualizer(int bars = NUM_BARS, const CaptureConfig& config = {}, bool capture = true, TraceWriter* trace = nullptr,
+                             SpectrumRingWriter* ring = nullptr)
+        : config(config), trace(trace), ring(ring) { set_bar_count(bars); if (capture) setup_pulseaudio(); }
+    ~AudioVisualizer() { cleanup_pulseaudio(); }
+    const std::vector<float>& get_levels() const { return smoothed_levels; }
+    void set_bar_count(int bars);
+    // Corks the capture stream while paused so the sound server stops delivering fragments
+    void set_playing(bool p);
+    // Advances smoothing by dt_ms (rates are tuned for a 60 Hz frame); returns whether any level moved
+    bool update(double dt_ms);
+    bool is_idle() const;
+    // Monotonic time at which the fragment behind the current levels arrived, for audio-to-screen latency
+    gint64 frame_time() const { return shown_time; }
+    // Analyzes interleaved float samples and publishes a frame; called from a single producer thread only
+    void feed(const float* samples, size_t n_frames, int n_channels);
+    const CaptureConfig& capture_config() const { return config; }
+    // Analyse only every stride-th fragment; the others still enter the FFT window, so only the update rate drops
+    void set_analysis_stride(int s) { stride.store(std::max(1, s), std::memory_order_relaxed); }
+private:
+    // generation is the play/pause generation the fragment was captured in; frames from an earlier one are stale
+    struct LevelFrame { std::array<float, SpectrumAnalyzer::MAX_BARS> levels; int bars = 0; gint64 time = 0; unsigned generation = 0; };
+    // Capture and analysis run on the PulseAudio thread; everything below the analyzer is UI-thread only
+    const CaptureConfig config;
+    pa_threaded_mainloop* mainloop = nullptr;
+    static constexpr pa_usec_t RECONNECT_US = 1000000;
+    pa_context* context = nullptr; pa_stream* stream = nullptr; std::string sink; bool closing = false;
+    SpectrumAnalyzer analyzer; TripleBuffer<LevelFrame> frames;
+    std::vector<float> levels, smoothed_levels; gint64 shown_time = 0; std::atomic<bool> playing{false}; std::atomic<unsigned> generation{0};
+    TraceWriter* trace; SpectrumRingWriter* ring; std::atomic<int> stride{1}; unsigned fragments = 0;
+    void setup_pulseaudio();
+    void cleanup_pulseaudio();
+    void connect_context();
+    void drop_context();
+    static void reconnect_cb(pa_mainloop_api* api, pa_time_event* e, const timeval*, void* u);
+    static void ctx_cb(pa_context* c, void* u);
+    void setup_stream();
+    static void subscribe_cb(pa_context* c, pa_subscription_event_type_t t, uint32_t idx, void* u);
+    static void srv_cb(pa_context* c, const pa_server_info* i, void* u);
+    static void stream_cb(pa_stream* s, void* u);
+    static void read_cb(pa_stream* s, size_t len, void* u);
+};
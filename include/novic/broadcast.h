@@ -0,0 +1,63 @@
+#pragma once
+#include "novic/dbus_properties.h"
+#include "novic/media_monitor.h"
+#include <giomm.h>
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Shared-memory ring of analysed spectrum frames, mapped at /dev/shm/novic-spectrum-<uid>. One writer (Novic's
+// capture thread) and any number of readers; each slot is a seqlock, so readers never take a lock or make a syscall.
+struct SpectrumRingLayout {
+    static constexpr uint32_t MAGIC = 0x5253564e, VERSION = 1, SLOTS = 64, MAX_BARS = 16;
+    struct Slot { std::atomic<uint64_t> seq; int64_t time; uint32_t bars; float levels[MAX_BARS]; };
+    uint32_t magic, version, slots, max_bars;
+    std::atomic<uint64_t> head; // frames written so far; frame n lives in slot n % SLOTS
+    Slot slot[SLOTS];
+};
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "the ring's atomics must be address-free to live in shared memory");
+
+struct SpectrumFrame { int64_t time = 0; std::vector<float> levels; };
+
+class SpectrumRingWriter {
+public:
+    explicit SpectrumRingWriter(const std::string& name = default_name());
+    ~SpectrumRingWriter();
+    bool is_open() const { return ring != nullptr; }
+    const std::string& name() const { return shm_name; }
+    // time is g_get_monotonic_time(), which is comparable across processes; never allocates
+    void publish(const float* levels, size_t bars, int64_t time);
+    static std::string default_name();
+private:
+    std::string shm_name; SpectrumRingLayout* ring = nullptr; uint64_t written = 0;
+};
+
+class SpectrumRingReader {
+public:
+    explicit SpectrumRingReader(const std::string& name = SpectrumRingWriter::default_name());
+    ~SpectrumRingReader();
+    bool is_open() const { return ring != nullptr; }
+    // Number of frames published so far
+    uint64_t head() const { return ring ? ring->head.load(std::memory_order_acquire) : 0; }
+    // Copies frame n; false if it was overwritten (the reader fell more than SLOTS behind) or is being written
+    bool read(uint64_t n, SpectrumFrame& out) const;
+    bool latest(SpectrumFrame& out) const { uint64_t h = head(); return h && read(h - 1, out); }
+private:
+    const SpectrumRingLayout* ring = nullptr;
+};
+
+// Publishes the monitor's current track as org.novic.NowPlaying at /org/novic/NowPlaying, with
+// PropertiesChanged pushed on every change so consumers never poll MPRIS themselves
+class NowPlayingService : public sigc::trackable {
+public:
+    NowPlayingService(const Glib::RefPtr<Gio::DBus::Connection>& conn, MediaMonitor& monitor, const std::string& spectrum_ring);
+    ~NowPlayingService();
+private:
+    using PropMap = DBusPropertyMap;
+    Glib::RefPtr<Gio::DBus::Connection> conn; Gio::DBus::InterfaceVTable vtable; guint registration = 0;
+    PropMap props;
+    void on_media(MediaMonitor::MediaInfo info);
+    void on_get_property(Glib::VariantBase& property, const Glib::RefPtr<Gio::DBus::Connection>&, const Glib::ustring&, const Glib::ustring&,
+                         const Glib::ustring&, const Glib::ustring& name);
+};
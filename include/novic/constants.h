@@ -0,0 +1,9 @@
+#pragma once
+
+constexpr int NUM_BARS = 7;
+constexpr int COLLAPSED_WIDTH = 400;
+constexpr int COLLAPSED_HEIGHT = 60;
+constexpr int EXPANDED_WIDTH = 620;
+constexpr int EXPANDED_HEIGHT = 240;
+constexpr int ALBUM_ART_SIZE = 90;
+constexpr int ICON_SIZE = 32;
@@ -0,0 +1,12 @@
+#pragma once
+#include <giomm.h>
+#include <map>
+
+using DBusPropertyMap = std::map<Glib::ustring, Glib::VariantBase>;
+
+// Copies the entries of next that are new or differ into props and returns just those
+DBusPropertyMap update_properties(DBusPropertyMap& props, const DBusPropertyMap& next);
+
+// org.freedesktop.DBus.Properties.PropertiesChanged for iface at path, with no invalidated properties; throws Glib::Error
+void emit_properties_changed(const Glib::RefPtr<Gio::DBus::Connection>& conn, const Glib::ustring& path, const Glib::ustring& iface,
+                             const DBusPropertyMap& changed);
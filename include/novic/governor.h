@@ -0,0 +1,62 @@
+#pragma once
+#include "novic/dbus_properties.h"
+#include "novic/stats.h"
+#include <giomm.h>
+#include <array>
+#include <cstdint>
+#include <vector>
+
+// Steps rendering and analysis quality down while measured CPU use exceeds a budget, and back up once there is
+// headroom again. Cost is read from the Stats histograms (update, window draw, read_cb), so nothing extra is timed.
+class QualityGovernor : public sigc::trackable {
+public:
+    enum class Tier { Full, HalfRate, CheapAnalysis, LowRate, Static, Count };
+    struct Config {
+        double budget = 2.0, battery_budget = 0.5; // percent of one core
+        bool upower_session_bus = false;           // watch a stand-in UPower on the session bus instead of the system one
+    };
+    explicit QualityGovernor(const Config& config);
+    // Evaluates only while the bar animates or captures; an idle bar has nothing to measure and is not woken
+    void set_active(bool active);
+    Tier tier() const { return current; }
+    double load() const { return current_load; }
+    double budget() const { return on_battery ? config.battery_budget : config.budget; }
+    bool is_on_battery() const { return on_battery; }
+    // Process one frame-clock tick in this many; 0 means show a static indicator instead of animating
+    int frame_divisor() const;
+    // Analyse one captured fragment in this many
+    int analysis_stride() const;
+    static const char* name(Tier t);
+    sigc::signal<void(Tier, Tier)> signal_tier_changed() { return tier_sig; }
+    // Fires after every evaluation window, with or without a tier change, and when the power source changes
+    sigc::signal<void()> signal_evaluated() { return evaluated_sig; }
+private:
+    static constexpr int WINDOW_MS = 2000, CALM_WINDOWS = 2; static constexpr gint64 RETRY_US = 30000000;
+    const Config config; Tier current = Tier::Full; double current_load = 0; bool on_battery = false, active = false, evaluating = false; int calm = 0;
+    uint64_t last_used = 0; gint64 last_eval = 0; std::array<gint64, (size_t)Tier::Count> exceeded_at{}; double static_budget = 0;
+    sigc::connection static_probe;
+    Glib::RefPtr<Gio::DBus::Proxy> upower; sigc::signal<void(Tier, Tier)> tier_sig; sigc::signal<void()> evaluated_sig;
+    static uint64_t used_us();
+    bool evaluate();
+    void set_tier(Tier t);
+    bool on_static_probe();
+    void on_upower_ready(Glib::RefPtr<Gio::AsyncResult>& r);
+    void on_upower_changed(const Gio::DBus::Proxy::MapChangedProperties& changed, const std::vector<Glib::ustring>&);
+};
+
+// Exports the governor as org.novic.Governor at /org/novic/Governor: Tier, Budget, Load and OnBattery properties
+// (PropertiesChanged after every evaluation that moves them) and TierChanged(s from, s to, d load)
+class GovernorService : public sigc::trackable {
+public:
+    GovernorService(const Glib::RefPtr<Gio::DBus::Connection>& conn, QualityGovernor& governor);
+    ~GovernorService();
+private:
+    using PropMap = DBusPropertyMap;
+    Glib::RefPtr<Gio::DBus::Connection> conn; QualityGovernor& governor; Gio::DBus::InterfaceVTable vtable; guint registration = 0;
+    PropMap props;
+    PropMap snapshot() const;
+    void on_tier_changed(QualityGovernor::Tier from, QualityGovernor::Tier to);
+    void on_evaluated();
+    void on_get_property(Glib::VariantBase& property, const Glib::RefPtr<Gio::DBus::Connection>&, const Glib::ustring&, const Glib::ustring&,
+                         const Glib::ustring&, const Glib::ustring& name);
+};
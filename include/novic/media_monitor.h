@@ -0,0 +1,70 @@
+#pragma once
+#include <giomm.h>
+#include <giomm/dbusproxy.h>
+#include "novic/stats.h"
+#include "novic/trace.h"
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+// Follows MPRIS players on the session bus and reports the one worth showing (first playing, else first paused)
+class MediaMonitor : public sigc::trackable {
+public:
+    struct MediaInfo {
+        std::string title, artist, album, player_name, icon_name, art_url, bus_name; bool is_playing = false;
+        int64_t position = 0, length = 0; gint64 position_time = 0; double rate = 1.0;
+        // Position in microseconds at monotonic time now, extrapolated from the last known anchor
+        int64_t position_at(gint64 now) const {
+            int64_t p = position + (is_playing && position_time ? (int64_t)((now - position_time) * rate) : 0);
+            return length > 0 ? std::clamp<int64_t>(p, 0, length) : std::max<int64_t>(p, 0);
+        }
+    };
+    MediaMonitor();
+    ~MediaMonitor();
+    MediaInfo get_current_media() const { return current; }
+    // Track, artist, album, art or length changed (also fires when the active player switches or goes away)
+    sigc::signal<void(MediaInfo)> signal_metadata_changed() { return metadata_sig; }
+    // Playback status or rate changed
+    sigc::signal<void(MediaInfo)> signal_status_changed() { return status_sig; }
+    // The position anchor moved (seek, resync, status change); use MediaInfo::position_at() between anchors
+    sigc::signal<void(MediaInfo)> signal_position_changed() { return position_sig; }
+    // Records player appearance, property changes and seeks as they arrive; the writer must outlive the monitor
+    void set_trace(TraceWriter* t) { trace = t; }
+    // Commands never block: play/pause is reflected immediately and corrected if the player disagrees, and
+    // next/previous presses made while one is in flight are netted and sent once it completes
+    void play_pause();
+    void next() { skip(1); } void previous() { skip(-1); }
+private:
+    static constexpr const char* MPRIS_PREFIX = "org.mpris.MediaPlayer2.";
+    static constexpr int COMMAND_TIMEOUT_MS = 3000, TOGGLE_GRACE_MS = 500;
+    struct Player { Glib::RefPtr<Gio::DBus::Proxy> proxy; int64_t position = 0; gint64 position_time = 0; double rate = 1.0; bool playing = false; std::string track; };
+    Glib::RefPtr<Gio::DBus::Connection> conn; guint name_watch = 0;
+    std::map<Glib::ustring, Player> players;
+    MediaInfo current; sigc::signal<void(MediaInfo)> metadata_sig, status_sig, position_sig;
+    TraceWriter* trace = nullptr;
+    void record(TraceKind kind, const Glib::ustring& name, const Glib::VariantBase& arg = {});
+    Glib::RefPtr<Gio::Cancellable> toggle_cancel, skip_cancel; Glib::ustring toggle_target, skip_target; int pending_skip = 0; bool skipping = false;
+    sigc::connection toggle_grace; bool toggle_confirmed = false;
+    void skip(int n);
+    void send_skip();
+    void cancel_commands(const Glib::ustring& vanished);
+    void on_toggle_done(Glib::RefPtr<Gio::AsyncResult>& r, Glib::RefPtr<Gio::Cancellable> cancel, Glib::ustring name, gint64 sent);
+    bool on_toggle_grace(Glib::RefPtr<Gio::Cancellable> cancel, Glib::ustring name);
+    void on_toggle_status(Glib::RefPtr<Gio::AsyncResult>& r, Glib::RefPtr<Gio::Cancellable> cancel, Glib::ustring name, gint64 sent);
+    void reconcile_playing(const Glib::ustring& name, const Glib::VariantBase& status);
+    void on_skip_done(Glib::RefPtr<Gio::AsyncResult>& r, Glib::RefPtr<Gio::Cancellable> cancel, gint64 sent);
+    void on_bus_ready(Glib::RefPtr<Gio::AsyncResult>& r);
+    void on_list_names(Glib::RefPtr<Gio::AsyncResult>& r, gint64 sent);
+    void on_name_owner_changed(const Glib::RefPtr<Gio::DBus::Connection>&, const Glib::ustring&, const Glib::ustring&,
+                               const Glib::ustring&, const Glib::ustring&, const Glib::VariantContainerBase& params);
+    void add_player(const Glib::ustring& name);
+    void on_proxy_ready(Glib::RefPtr<Gio::AsyncResult>& r, Glib::ustring name, gint64 sent);
+    void on_properties_changed(const Gio::DBus::Proxy::MapChangedProperties& changed, const std::vector<Glib::ustring>&, Glib::ustring name);
+    void on_player_signal(const Glib::ustring&, const Glib::ustring& signal, const Glib::VariantContainerBase& params, Glib::ustring name);
+    void fetch_position(const Glib::ustring& name);
+    void on_position(Glib::RefPtr<Gio::AsyncResult>& r, Glib::ustring name, gint64 sent);
+    void refresh();
+    MediaInfo get_info(const Glib::ustring& bus, const Player& p) const;
+};
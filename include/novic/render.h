@@ -0,0 +1,25 @@
+#pragma once
+#include <cairomm/cairomm.h>
+#include <vector>
+
+// Draws rounded visualizer bars from pre-rasterised cap sprites: every bar is a top cap, a plain
+// rectangle body and a bottom cap, so no arcs are tessellated per frame
+class BarSprite {
+public:
+    void draw(const Cairo::RefPtr<Cairo::Context>& cr, const std::vector<float>& levels, double bw, double bs, double sx, double mh, double cy, int scale);
+private:
+    Cairo::RefPtr<Cairo::Surface> top, bottom; double cap_w = 0; int cap_scale = 0;
+};
+
+// The window's rounded-bottom background, rasterised once per size and scale factor
+class BackgroundCache {
+public:
+    void draw(const Cairo::RefPtr<Cairo::Context>& cr, int w, int h, int scale);
+private:
+    Cairo::RefPtr<Cairo::Surface> surface; int sw = 0, sh = 0, sscale = 0;
+};
+
+// Bar and progress layouts for a w x h area, shared by the window and novic_bench
+void draw_collapsed_bars(const Cairo::RefPtr<Cairo::Context>& cr, BarSprite& sprite, const std::vector<float>& levels, double w, double h, int scale);
+void draw_expanded_bars(const Cairo::RefPtr<Cairo::Context>& cr, BarSprite& sprite, const std::vector<float>& levels, double w, double h, int scale);
+void draw_progress(const Cairo::RefPtr<Cairo::Context>& cr, double w, double h, double progress);
@@ -0,0 +1,24 @@
+#pragma once
+#include "novic/constants.h"
+#include <cstddef>
+#include <vector>
+
+// Windowed real FFT with log-spaced band grouping; all buffers are planned up front so the
+// per-fragment path never allocates
+class SpectrumAnalyzer {
+public:
+    static constexpr int FFT_SIZE = 1024;
+    static constexpr int MAX_BARS = 16;
+    explicit SpectrumAnalyzer(int bars = NUM_BARS, float rate = 44100.0f) { configure(bars, rate); }
+    // Rebuilds the plan; allocates, so call it off the hot path
+    void configure(int bars, float rate);
+    int bar_count() const { return (int)edges.size() - 1; }
+    // Appends interleaved samples to the analysis window, downmixed to mono; allocation-free
+    void push(const float* samples, size_t frames, int channels);
+    // Writes bar_count() levels in [0, 1] for the most recent FFT_SIZE samples; allocation-free
+    void analyze(float* out);
+private:
+    static constexpr float FLOOR_DB = -60.0f;
+    std::vector<float> history, frame, window, re, im, xre, xim, power, tw_re, tw_im, post_re, post_im;
+    std::vector<int> bitrev, edges;
+};
@@ -0,0 +1,61 @@
+#pragma once
+#include <giomm.h>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+// Lock-free latency histogram with power-of-two microsecond buckets; record() is safe from any thread
+class Histogram {
+public:
+    static constexpr int BUCKETS = 32;
+    struct Summary { uint64_t count = 0, total_us = 0, max_us = 0, p50_us = 0, p95_us = 0, p99_us = 0; };
+    void record(int64_t us);
+    // Percentiles are the upper bound of the bucket they fall in, so they are accurate to within 2x
+    Summary summary() const;
+    void reset();
+private:
+    std::array<std::atomic<uint64_t>, BUCKETS> buckets{}; std::atomic<uint64_t> count{0}, total{0}, max{0};
+};
+
+// Process-wide hot-path metrics, cheap enough to leave on in release builds
+class Stats {
+public:
+    enum class Metric { Update, DrawWindow, DrawViz, DrawExpandedViz, DrawAlbumArt, DrawProgress, ReadCallback, AudioToScreen, DbusRoundTrip, ArtLoad, MainLoopStall, Count };
+    enum class Counter { ArtMemoryHit, ArtDiskHit, ArtLoaded, ArtFailed, TierChange, Count };
+    static Stats& get();
+    void record(Metric m, int64_t us) { histograms[(size_t)m].record(us); }
+    void count(Counter c) { counters[(size_t)c].fetch_add(1, std::memory_order_relaxed); }
+    const Histogram& histogram(Metric m) const { return histograms[(size_t)m]; }
+    uint64_t counter(Counter c) const { return counters[(size_t)c].load(std::memory_order_relaxed); }
+    static const char* name(Metric m);
+    static const char* name(Counter c);
+    void reset();
+    // Plain-text table of every histogram and counter, for the periodic log dump
+    std::string format() const;
+private:
+    std::array<Histogram, (size_t)Metric::Count> histograms; std::array<std::atomic<uint64_t>, (size_t)Counter::Count> counters{};
+};
+
+// Records the lifetime of the enclosing scope into a metric
+class ScopedTimer {
+public:
+    explicit ScopedTimer(Stats::Metric m) : metric(m), start(g_get_monotonic_time()) {}
+    ~ScopedTimer() { Stats::get().record(metric, g_get_monotonic_time() - start); }
+private:
+    Stats::Metric metric; gint64 start;
+};
+
+// Exports Stats as org.novic.Stats at /org/novic/Stats:
+//   GetHistograms() -> a(stttttt)  name, count, total, p50, p95, p99, max (microseconds)
+//   GetCounters() -> a{st}
+//   Reset()
+class StatsService {
+public:
+    explicit StatsService(const Glib::RefPtr<Gio::DBus::Connection>& conn);
+    ~StatsService();
+private:
+    Glib::RefPtr<Gio::DBus::Connection> conn; Gio::DBus::InterfaceVTable vtable; guint registration = 0;
+    void on_method_call(const Glib::RefPtr<Gio::DBus::Connection>&, const Glib::ustring&, const Glib::ustring&, const Glib::ustring&,
+                        const Glib::ustring& method, const Glib::VariantContainerBase&, const Glib::RefPtr<Gio::DBus::MethodInvocation>& invocation);
+};
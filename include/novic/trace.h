@@ -0,0 +1,43 @@
+#pragma once
+#include <glibmm.h>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Compact binary session trace: a "NVTR" header followed by records of
+//   u8 kind | i64 time (us since recording started) | u32 size | payload
+// D-Bus payloads are serialized GVariants of a fixed type per kind; PCM payloads are
+//   u32 rate | u32 channels | interleaved float32 samples
+enum class TraceKind : uint8_t {
+    PlayerAppeared = 1,    // (sa{sv})  bus name, every cached Player property
+    PlayerVanished = 2,    // (s)
+    PropertiesChanged = 3, // (sa{sv})  bus name, changed Player properties
+    Seeked = 4,            // (sx)      bus name, new position
+    Pcm = 5,
+};
+
+struct TraceRecord {
+    TraceKind kind{}; int64_t time = 0; std::vector<uint8_t> data;
+    // The record's GVariant payload; only meaningful for the D-Bus kinds
+    Glib::VariantContainerBase variant() const;
+    uint32_t pcm_rate() const; uint32_t pcm_channels() const;
+    const float* pcm_samples() const; size_t pcm_frames() const;
+};
+
+// Appends records to a trace file; safe to call from the UI and PulseAudio threads concurrently
+class TraceWriter {
+public:
+    explicit TraceWriter(const std::string& path);
+    ~TraceWriter();
+    bool is_open() const { return file != nullptr; }
+    void write_variant(TraceKind kind, const Glib::VariantContainerBase& v);
+    void write_pcm(uint32_t rate, uint32_t channels, const float* samples, size_t frames);
+private:
+    std::FILE* file = nullptr; gint64 start = 0; std::mutex mtx;
+    void write(TraceKind kind, const void* head, size_t head_size, const void* body, size_t body_size);
+};
+
+// Reads a whole trace into memory; returns false if the file is missing or not a trace
+bool read_trace(const std::string& path, std::vector<TraceRecord>& out);
@@ -0,0 +1,18 @@
+#pragma once
+#include <array>
+#include <atomic>
+
+// Wait-free single-producer/single-consumer handoff: the consumer always sees a complete, most recent T
+template <typename T> class TripleBuffer {
+public:
+    T& back() { return slots[back_idx]; }
+    void publish() { back_idx = middle.exchange(back_idx | FRESH, std::memory_order_acq_rel) & INDEX; }
+    bool fetch() {
+        if (!(middle.load(std::memory_order_relaxed) & FRESH)) return false;
+        front_idx = middle.exchange(front_idx, std::memory_order_acq_rel) & INDEX; return true;
+    }
+    const T& front() const { return slots[front_idx]; }
+private:
+    static constexpr int INDEX = 3, FRESH = 4;
+    std::array<T, 3> slots{}; int back_idx = 0, front_idx = 1; alignas(64) std::atomic<int> middle{2};
+};
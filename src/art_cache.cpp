@@ -0,0 +1,129 @@
+#include "novic/art_cache.h"
+#include "novic/constants.h"
+#include "novic/stats.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+
+ArtCache::ArtCache() : cancel(Gio::Cancellable::create()) {
+    cache_dir = Glib::build_filename(Glib::get_user_cache_dir(), "novic", "art");
+    // If this fails art is simply not persisted; load() treats the disk cache as best-effort
+    g_mkdir_with_parents(cache_dir.c_str(), 0700);
+    dispatcher.connect(sigc::mem_fun(*this, &ArtCache::on_loaded));
+    worker = std::thread(&ArtCache::run, this);
+}
+
+ArtCache::~ArtCache() {
+    cancel->cancel();
+    { std::lock_guard<std::mutex> l(mtx); stopping = true; }
+    cv.notify_one(); worker.join();
+}
+
+const ArtCache::Art* ArtCache::lookup(const std::string& url) {
+    auto it = index.find(url); if (it == index.end()) return nullptr;
+    lru.splice(lru.begin(), lru, it->second); return &it->second->second;
+}
+
+void ArtCache::request(const std::string& url) {
+    if (index.count(url) || !pending.insert(url).second) return;
+    { std::lock_guard<std::mutex> l(mtx); jobs.push_back(url); }
+    cv.notify_one();
+}
+
+void ArtCache::run() {
+    prune_disk();
+    for (;;) {
+        std::string url;
+        { std::unique_lock<std::mutex> l(mtx); cv.wait(l, [this]() { return stopping || !jobs.empty(); });
+          if (stopping) return; url = jobs.front(); jobs.pop_front(); }
+        auto r = load(url);
+        { std::lock_guard<std::mutex> l(mtx); loaded.push_back(r); }
+        dispatcher.emit();
+    }
+}
+
+// Worker thread: remote art comes from the disk cache when it can, otherwise it is decoded straight to
+// ALBUM_ART_SIZE and persisted. Local files are decoded every time, since the file can change under the same URL.
+ArtCache::Loaded ArtCache::load(const std::string& url) {
+    Loaded r; r.url = url; ScopedTimer timer(Stats::Metric::ArtLoad);
+    try {
+        if (url.find("file://") == 0) {
+            r.large = decode_square(Gio::File::create_for_uri(url)->read(cancel), ALBUM_ART_SIZE, cancel);
+            if (r.large) Stats::get().count(Stats::Counter::ArtLoaded);
+        } else if (url.find("http") == 0) {
+            auto path = Glib::build_filename(cache_dir, Glib::Checksum::compute_checksum(Glib::Checksum::CHECKSUM_SHA1, url) + ".png");
+            std::error_code ec;
+            if (Glib::file_test(path, Glib::FILE_TEST_EXISTS)) {
+                r.large = Gdk::Pixbuf::create_from_file(path); Stats::get().count(Stats::Counter::ArtDiskHit);
+                // The modification time doubles as the last-used time for prune_disk
+                std::filesystem::last_write_time(path, std::filesystem::file_time_type::clock::now(), ec);
+            } else {
+                r.large = decode_square(Gio::File::create_for_uri(url)->read(cancel), ALBUM_ART_SIZE, cancel);
+                if (r.large) {
+                    Stats::get().count(Stats::Counter::ArtLoaded);
+                    // Persisting is best-effort: a read-only or full cache directory must not cost the art itself
+                    auto tmp = path + ".tmp";
+                    try {
+                        r.large->save(tmp, "png");
+                        if (std::rename(tmp.c_str(), path.c_str()) == 0) { if (++saved % PRUNE_EVERY == 0) prune_disk(); } else std::remove(tmp.c_str());
+                    } catch (...) { std::remove(tmp.c_str()); }
+                }
+            }
+        }
+        if (r.large) r.small = r.large->scale_simple(ICON_SIZE, ICON_SIZE, Gdk::INTERP_BILINEAR);
+    } catch (...) {}
+    if (!r.small) Stats::get().count(Stats::Counter::ArtFailed);
+    return r;
+}
+
+// Worker thread: keeps the DISK_CAPACITY most recently used files
+void ArtCache::prune_disk() {
+    namespace fs = std::filesystem; std::error_code ec;
+    std::vector<std::pair<fs::file_time_type, fs::path>> files;
+    for (auto& e : fs::directory_iterator(cache_dir, ec)) {
+        auto t = e.last_write_time(ec); if (!ec && e.is_regular_file(ec)) files.emplace_back(t, e.path());
+    }
+    if (files.size() <= DISK_CAPACITY) return;
+    std::nth_element(files.begin(), files.begin() + DISK_CAPACITY, files.end(), [](auto& a, auto& b) { return a.first > b.first; });
+    for (auto it = files.begin() + DISK_CAPACITY; it != files.end(); ++it) fs::remove(it->second, ec);
+}
+
+// Scales while decoding so the shorter side lands on size (JPEG decodes straight to the reduced size), then
+// centre-crops to a square so covers that are not square keep their aspect ratio
+Glib::RefPtr<Gdk::Pixbuf> ArtCache::decode_square(const Glib::RefPtr<Gio::InputStream>& in, int size, const Glib::RefPtr<Gio::Cancellable>& cancel) {
+    auto loader = Gdk::PixbufLoader::create(); GdkPixbufLoader* raw = loader->gobj();
+    loader->signal_size_prepared().connect([raw, size](int w, int h) {
+        double s = (double)size / std::max(1, std::min(w, h));
+        gdk_pixbuf_loader_set_size(raw, std::max(size, (int)std::lround(w * s)), std::max(size, (int)std::lround(h * s)));
+    });
+    guint8 buf[16384];
+    try { for (gssize n; (n = in->read(buf, sizeof buf, cancel)) > 0;) loader->write(buf, n); loader->close(); }
+    catch (...) { try { loader->close(); } catch (...) {} throw; }
+    auto pb = loader->get_pixbuf(); if (!pb) return pb;
+    int w = pb->get_width(), h = pb->get_height(), s = std::min({w, h, size});
+    return Gdk::Pixbuf::create_subpixbuf(pb, (w - s) / 2, (h - s) / 2, s, s)->copy();
+}
+
+// UI thread: Cairo surfaces are created here since cairomm refcounts are not thread-safe
+void ArtCache::on_loaded() {
+    std::vector<Loaded> batch; { std::lock_guard<std::mutex> l(mtx); batch.swap(loaded); }
+    for (auto& r : batch) {
+        pending.erase(r.url);
+        // Failures are not cached, so art that was briefly unreachable loads on the next request
+        if (r.large && r.small) {
+            lru.emplace_front(r.url, Art{clipped(r.large, 10), clipped(r.small, 6)}); index[r.url] = lru.begin();
+            if (lru.size() > CAPACITY) { index.erase(lru.back().first); lru.pop_back(); }
+        }
+        sig.emit(r.url);
+    }
+}
+
+Cairo::RefPtr<Cairo::ImageSurface> ArtCache::clipped(const Glib::RefPtr<Gdk::Pixbuf>& pb, double r) {
+    double s = pb->get_width();
+    auto surf = Cairo::ImageSurface::create(Cairo::FORMAT_ARGB32, pb->get_width(), pb->get_height()); auto cr = Cairo::Context::create(surf);
+    cr->arc(r, r, r, M_PI, 3*M_PI/2); cr->arc(s-r, r, r, 3*M_PI/2, 0);
+    cr->arc(s-r, s-r, r, 0, M_PI/2); cr->arc(r, s-r, r, M_PI/2, M_PI); cr->close_path(); cr->clip();
+    Gdk::Cairo::set_source_pixbuf(cr, pb, 0, 0); cr->paint();
+    return surf;
+}
@@ -0,0 +1,140 @@
+#include "novic/audio_visualizer.h"
+#include "novic/broadcast.h"
+#include <algorithm>
+#include <cmath>
+#include <string>
+
+uint32_t CaptureConfig::fragment_bytes() const {
+    double ms = std::min(1000.0 / std::max(refresh_hz, 1.0), latency_ms);
+    return std::max<uint32_t>(1, (uint32_t)(rate * ms / 1000.0)) * channels * sizeof(float);
+}
+
+void AudioVisualizer::set_bar_count(int bars) {
+    if (mainloop) pa_threaded_mainloop_lock(mainloop);
+    analyzer.configure(bars, config.rate); int n = analyzer.bar_count();
+    if (mainloop) pa_threaded_mainloop_unlock(mainloop);
+    levels.assign(n, 0.0f); smoothed_levels.assign(n, 0.0f);
+}
+
+void AudioVisualizer::set_playing(bool p) {
+    if (playing.exchange(p) == p) return;
+    // Frames already waiting in the triple buffer (or analysed before the cork lands) belong to the old state
+    generation.fetch_add(1, std::memory_order_release);
+    if (!p) for (auto& l : levels) l = 0.0f;
+    if (!mainloop) return;
+    pa_threaded_mainloop_lock(mainloop);
+    if (stream && pa_stream_get_state(stream) == PA_STREAM_READY) { auto op = pa_stream_cork(stream, !p, nullptr, nullptr); if (op) pa_operation_unref(op); }
+    pa_threaded_mainloop_unlock(mainloop);
+}
+
+bool AudioVisualizer::update(double dt_ms) {
+    if (frames.fetch() && playing && frames.front().generation == generation.load(std::memory_order_acquire) && frames.front().bars == (int)levels.size()) { std::copy_n(frames.front().levels.begin(), levels.size(), levels.begin()); shown_time = frames.front().time; }
+    float frames_elapsed = std::min(dt_ms, 100.0) / 16.67, rise = 1.0f - std::pow(0.6f, frames_elapsed), decay = std::pow(0.88f, frames_elapsed);
+    bool changed = false;
+    for (size_t i = 0; i < levels.size(); i++) {
+        float prev = smoothed_levels[i];
+        if (levels[i] > smoothed_levels[i]) smoothed_levels[i] += (levels[i] - smoothed_levels[i]) * rise;
+        else smoothed_levels[i] *= decay;
+        smoothed_levels[i] = std::clamp(smoothed_levels[i], 0.0f, 1.0f);
+        if (smoothed_levels[i] < 0.02f) smoothed_levels[i] = 0.0f;
+        changed |= smoothed_levels[i] != prev;
+    }
+    return changed;
+}
+
+bool AudioVisualizer::is_idle() const { return std::all_of(smoothed_levels.begin(), smoothed_levels.end(), [](float l) { return l == 0.0f; }); }
+
+void AudioVisualizer::setup_pulseaudio() {
+    mainloop = pa_threaded_mainloop_new(); if (!mainloop) return;
+    connect_context();
+    pa_threaded_mainloop_start(mainloop);
+}
+
+// NOFAIL waits in CONNECTING for a sound server that is not up yet at login, or is restarting, instead of failing
+void AudioVisualizer::connect_context() {
+    context = pa_context_new(pa_threaded_mainloop_get_api(mainloop), "Novic"); if (!context) return;
+    pa_context_set_state_callback(context, ctx_cb, this);
+    pa_context_connect(context, nullptr, PA_CONTEXT_NOFAIL, nullptr);
+}
+
+// The server went away: drop the stream and forget the sink so srv_cb reconnects capture once a new context is
+// ready. A context cannot be released from its own state callback, so the new one is made from a timer event.
+void AudioVisualizer::drop_context() {
+    if (stream) { pa_stream_disconnect(stream); pa_stream_unref(stream); stream = nullptr; }
+    sink.clear();
+    auto* api = pa_threaded_mainloop_get_api(mainloop); timeval tv; pa_gettimeofday(&tv); pa_timeval_add(&tv, RECONNECT_US);
+    api->time_new(api, &tv, reconnect_cb, this);
+}
+
+void AudioVisualizer::reconnect_cb(pa_mainloop_api* api, pa_time_event* e, const timeval*, void* u) {
+    api->time_free(e);
+    auto* self = static_cast<AudioVisualizer*>(u); if (self->closing) return;
+    if (self->context) { pa_context_set_state_callback(self->context, nullptr, nullptr); pa_context_unref(self->context); self->context = nullptr; }
+    self->connect_context();
+}
+
+void AudioVisualizer::cleanup_pulseaudio() {
+    if (!mainloop) return;
+    pa_threaded_mainloop_lock(mainloop);
+    closing = true;
+    if (stream) { pa_stream_disconnect(stream); pa_stream_unref(stream); }
+    if (context) { pa_context_set_state_callback(context, nullptr, nullptr); pa_context_disconnect(context); pa_context_unref(context); }
+    pa_threaded_mainloop_unlock(mainloop);
+    pa_threaded_mainloop_stop(mainloop); pa_threaded_mainloop_free(mainloop);
+}
+
+// Server events include default-sink changes, which move capture to the new sink's monitor
+void AudioVisualizer::ctx_cb(pa_context* c, void* u) {
+    auto state = pa_context_get_state(c);
+    if (state == PA_CONTEXT_FAILED || state == PA_CONTEXT_TERMINATED) { static_cast<AudioVisualizer*>(u)->drop_context(); return; }
+    if (state != PA_CONTEXT_READY) return;
+    pa_context_set_subscribe_callback(c, subscribe_cb, u);
+    auto op = pa_context_subscribe(c, PA_SUBSCRIPTION_MASK_SERVER, nullptr, nullptr); if (op) pa_operation_unref(op);
+    static_cast<AudioVisualizer*>(u)->setup_stream();
+}
+
+void AudioVisualizer::subscribe_cb(pa_context*, pa_subscription_event_type_t t, uint32_t, void* u) {
+    if ((t & PA_SUBSCRIPTION_EVENT_FACILITY_MASK) == PA_SUBSCRIPTION_EVENT_SERVER) static_cast<AudioVisualizer*>(u)->setup_stream();
+}
+
+
+void AudioVisualizer::setup_stream() { auto op = pa_context_get_server_info(context, srv_cb, this); if (op) pa_operation_unref(op); }
+
+void AudioVisualizer::srv_cb(pa_context* c, const pa_server_info* i, void* u) {
+    auto* s = static_cast<AudioVisualizer*>(u); if (!i || !i->default_sink_name || s->sink == i->default_sink_name) return;
+    if (s->stream) { pa_stream_disconnect(s->stream); pa_stream_unref(s->stream); s->stream = nullptr; }
+    s->sink = i->default_sink_name;
+    pa_sample_spec ss = {PA_SAMPLE_FLOAT32LE, s->config.rate, s->config.channels};
+    s->stream = pa_stream_new(c, "Novic", &ss, nullptr); if (!s->stream) return;
+    pa_stream_set_read_callback(s->stream, read_cb, u); pa_stream_set_state_callback(s->stream, stream_cb, u);
+    pa_buffer_attr a = {(uint32_t)-1,(uint32_t)-1,(uint32_t)-1,(uint32_t)-1,s->config.fragment_bytes()};
+    auto flags = (pa_stream_flags_t)(PA_STREAM_ADJUST_LATENCY | (s->playing ? 0 : PA_STREAM_START_CORKED));
+    pa_stream_connect_record(s->stream, (s->sink+".monitor").c_str(), &a, flags);
+}
+
+// set_playing() can race the stream becoming ready, so reconcile the cork state once it is
+void AudioVisualizer::stream_cb(pa_stream* s, void* u) {
+    if (pa_stream_get_state(s) != PA_STREAM_READY) return;
+    bool corked = !static_cast<AudioVisualizer*>(u)->playing;
+    if (pa_stream_is_corked(s) != corked) { auto op = pa_stream_cork(s, corked, nullptr, nullptr); if (op) pa_operation_unref(op); }
+}
+
+void AudioVisualizer::read_cb(pa_stream* s, size_t len, void* u) {
+    auto* self = static_cast<AudioVisualizer*>(u); const void* d;
+    if (pa_stream_peek(s, &d, &len) < 0) return;
+    if (!d) { if (len) pa_stream_drop(s); return; }
+    ScopedTimer timer(Stats::Metric::ReadCallback);
+    auto& cfg = self->config; size_t n = len / (sizeof(float) * cfg.channels);
+    if (self->trace) self->trace->write_pcm(cfg.rate, cfg.channels, static_cast<const float*>(d), n);
+    self->feed(static_cast<const float*>(d), n, cfg.channels);
+    pa_stream_drop(s);
+}
+
+void AudioVisualizer::feed(const float* samples, size_t n_frames, int n_channels) {
+    gint64 arrived = g_get_monotonic_time(); unsigned gen = generation.load(std::memory_order_acquire);
+    analyzer.push(samples, n_frames, n_channels);
+    if (++fragments % stride.load(std::memory_order_relaxed)) return;
+    auto& f = frames.back(); f.time = arrived; f.generation = gen; analyzer.analyze(f.levels.data()); f.bars = analyzer.bar_count();
+    if (ring) ring->publish(f.levels.data(), f.bars, arrived);
+    frames.publish();
+}
@@ -0,0 +1,103 @@
+#include "novic/broadcast.h"
+#include "novic/spectrum_analyzer.h"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstring>
+
+// The layout is shared with other processes, so it keeps its own constant rather than following the analyzer
+static_assert((int)SpectrumRingLayout::MAX_BARS >= SpectrumAnalyzer::MAX_BARS, "ring slots must hold every bar the analyzer can produce");
+
+namespace {
+
+constexpr const char* NOW_PLAYING_XML =
+    "<node><interface name='org.novic.NowPlaying'>"
+    "<property name='Title' type='s' access='read'/><property name='Artist' type='s' access='read'/>"
+    "<property name='Album' type='s' access='read'/><property name='ArtUrl' type='s' access='read'/>"
+    "<property name='Player' type='s' access='read'/><property name='Playing' type='b' access='read'/>"
+    "<property name='Rate' type='d' access='read'/><property name='Length' type='x' access='read'/>"
+    "<property name='Position' type='x' access='read'/><property name='PositionTime' type='x' access='read'/>"
+    "<property name='SpectrumRing' type='s' access='read'/>"
+    "</interface></node>";
+
+}
+
+std::string SpectrumRingWriter::default_name() { return "/novic-spectrum-" + std::to_string(getuid()); }
+
+SpectrumRingWriter::SpectrumRingWriter(const std::string& name) : shm_name(name) {
+    int fd = shm_open(name.c_str(), O_CREAT | O_RDWR, 0600); if (fd < 0) return;
+    void* p = ftruncate(fd, sizeof(SpectrumRingLayout)) == 0 ? mmap(nullptr, sizeof(SpectrumRingLayout), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) : MAP_FAILED;
+    close(fd); if (p == MAP_FAILED) { shm_unlink(name.c_str()); return; }
+    // A previous instance may have left frames behind; readers only trust the header once magic is set
+    ring = static_cast<SpectrumRingLayout*>(p); ring->magic = 0;
+    ring->head.store(0, std::memory_order_relaxed);
+    for (auto& s : ring->slot) s.seq.store(0, std::memory_order_relaxed);
+    ring->version = SpectrumRingLayout::VERSION; ring->slots = SpectrumRingLayout::SLOTS; ring->max_bars = SpectrumRingLayout::MAX_BARS;
+    std::atomic_thread_fence(std::memory_order_release); ring->magic = SpectrumRingLayout::MAGIC;
+}
+
+SpectrumRingWriter::~SpectrumRingWriter() { if (ring) { munmap(ring, sizeof(SpectrumRingLayout)); shm_unlink(shm_name.c_str()); } }
+
+void SpectrumRingWriter::publish(const float* levels, size_t bars, int64_t time) {
+    if (!ring) return;
+    uint64_t n = written++; auto& s = ring->slot[n % SpectrumRingLayout::SLOTS];
+    s.seq.store(2 * n + 1, std::memory_order_relaxed); std::atomic_thread_fence(std::memory_order_release);
+    s.time = time; s.bars = std::min<size_t>(bars, SpectrumRingLayout::MAX_BARS);
+    std::memcpy(s.levels, levels, s.bars * sizeof(float));
+    s.seq.store(2 * n + 2, std::memory_order_release);
+    ring->head.store(n + 1, std::memory_order_release);
+}
+
+SpectrumRingReader::SpectrumRingReader(const std::string& name) {
+    int fd = shm_open(name.c_str(), O_RDONLY, 0); if (fd < 0) return;
+    void* p = mmap(nullptr, sizeof(SpectrumRingLayout), PROT_READ, MAP_SHARED, fd, 0); close(fd);
+    if (p == MAP_FAILED) return;
+    auto* r = static_cast<const SpectrumRingLayout*>(p);
+    if (r->magic != SpectrumRingLayout::MAGIC || r->version != SpectrumRingLayout::VERSION) { munmap(p, sizeof(SpectrumRingLayout)); return; }
+    ring = r;
+}
+
+SpectrumRingReader::~SpectrumRingReader() { if (ring) munmap(const_cast<SpectrumRingLayout*>(ring), sizeof(SpectrumRingLayout)); }
+
+bool SpectrumRingReader::read(uint64_t n, SpectrumFrame& out) const {
+    if (!ring) return false;
+    auto& s = ring->slot[n % SpectrumRingLayout::SLOTS];
+    uint64_t before = s.seq.load(std::memory_order_acquire); if (before != 2 * n + 2) return false;
+    float levels[SpectrumRingLayout::MAX_BARS]; int64_t time = s.time; uint32_t bars = std::min(s.bars, SpectrumRingLayout::MAX_BARS);
+    std::memcpy(levels, s.levels, bars * sizeof(float));
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (s.seq.load(std::memory_order_relaxed) != before) return false;
+    out.time = time; out.levels.assign(levels, levels + bars); return true;
+}
+
+NowPlayingService::NowPlayingService(const Glib::RefPtr<Gio::DBus::Connection>& conn, MediaMonitor& monitor, const std::string& spectrum_ring)
+    : conn(conn), vtable(Gio::DBus::InterfaceVTable::SlotInterfaceMethodCall(), sigc::mem_fun(*this, &NowPlayingService::on_get_property)) {
+    props["SpectrumRing"] = Glib::Variant<Glib::ustring>::create(spectrum_ring);
+    on_media(monitor.get_current_media());
+    try { registration = conn->register_object("/org/novic/NowPlaying", Gio::DBus::NodeInfo::create_for_xml(NOW_PLAYING_XML)->lookup_interface("org.novic.NowPlaying"), vtable); } catch(...) {}
+    monitor.signal_metadata_changed().connect(sigc::mem_fun(*this, &NowPlayingService::on_media));
+    monitor.signal_status_changed().connect(sigc::mem_fun(*this, &NowPlayingService::on_media));
+    monitor.signal_position_changed().connect(sigc::mem_fun(*this, &NowPlayingService::on_media));
+}
+
+NowPlayingService::~NowPlayingService() { if (registration) conn->unregister_object(registration); }
+
+// Only properties whose value actually moved are pushed
+void NowPlayingService::on_media(MediaMonitor::MediaInfo info) {
+    PropMap next = {
+        {"Title", Glib::Variant<Glib::ustring>::create(info.title)}, {"Artist", Glib::Variant<Glib::ustring>::create(info.artist)},
+        {"Album", Glib::Variant<Glib::ustring>::create(info.album)}, {"ArtUrl", Glib::Variant<Glib::ustring>::create(info.art_url)},
+        {"Player", Glib::Variant<Glib::ustring>::create(info.player_name)}, {"Playing", Glib::Variant<bool>::create(info.is_playing)},
+        {"Rate", Glib::Variant<double>::create(info.rate)}, {"Length", Glib::Variant<gint64>::create(info.length)},
+        {"Position", Glib::Variant<gint64>::create(info.position)}, {"PositionTime", Glib::Variant<gint64>::create(info.position_time)},
+    };
+    PropMap changed = update_properties(props, next);
+    if (changed.empty() || !registration) return;
+    try { emit_properties_changed(conn, "/org/novic/NowPlaying", "org.novic.NowPlaying", changed); } catch(...) {}
+}
+
+void NowPlayingService::on_get_property(Glib::VariantBase& property, const Glib::RefPtr<Gio::DBus::Connection>&, const Glib::ustring&, const Glib::ustring&,
+                                        const Glib::ustring&, const Glib::ustring& name) {
+    auto it = props.find(name); if (it != props.end()) property = it->second;
+}
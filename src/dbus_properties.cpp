@@ -0,0 +1,15 @@
+#include "novic/dbus_properties.h"
+#include <vector>
+
+DBusPropertyMap update_properties(DBusPropertyMap& props, const DBusPropertyMap& next) {
+    DBusPropertyMap changed;
+    for (auto& [k, v] : next) { auto it = props.find(k); if (it == props.end() || !it->second.equal(v)) { props[k] = v; changed[k] = v; } }
+    return changed;
+}
+
+void emit_properties_changed(const Glib::RefPtr<Gio::DBus::Connection>& conn, const Glib::ustring& path, const Glib::ustring& iface,
+                             const DBusPropertyMap& changed) {
+    conn->emit_signal(path, "org.freedesktop.DBus.Properties", "PropertiesChanged", {},
+        Glib::VariantContainerBase::create_tuple({Glib::Variant<Glib::ustring>::create(iface),
+            Glib::Variant<DBusPropertyMap>::create(changed), Glib::Variant<std::vector<Glib::ustring>>::create({})}));
+}
@@ -0,0 +1,139 @@
+#include "novic/governor.h"
+#include <cmath>
+
+namespace {
+
+constexpr const char* GOVERNOR_XML =
+    "<node><interface name='org.novic.Governor'>"
+    "<property name='Tier' type='s' access='read'/><property name='Budget' type='d' access='read'/>"
+    "<property name='Load' type='d' access='read'/><property name='OnBattery' type='b' access='read'/>"
+    "<signal name='TierChanged'><arg name='from' type='s'/><arg name='to' type='s'/><arg name='load' type='d'/></signal>"
+    "</interface></node>";
+
+}
+
+// Only a UPower that is already running is watched; without one the governor stays on the AC budget
+QualityGovernor::QualityGovernor(const Config& config) : config(config) {
+    Gio::DBus::Proxy::create_for_bus(config.upower_session_bus ? Gio::DBus::BUS_TYPE_SESSION : Gio::DBus::BUS_TYPE_SYSTEM,
+        "org.freedesktop.UPower", "/org/freedesktop/UPower", "org.freedesktop.UPower", sigc::mem_fun(*this, &QualityGovernor::on_upower_ready),
+        Glib::RefPtr<Gio::DBus::InterfaceInfo>(), Gio::DBus::PROXY_FLAGS_DO_NOT_AUTO_START);
+}
+
+// Each active period starts a fresh window, so time spent idle never dilutes the measured load; a timeout still
+// pending from the previous period carries on with it, or lapses unevaluated if the bar stays idle
+void QualityGovernor::set_active(bool a) {
+    if (a == active) return;
+    active = a; if (!active) return;
+    last_used = used_us(); last_eval = g_get_monotonic_time(); calm = 0;
+    if (evaluating) return;
+    evaluating = true;
+    Glib::signal_timeout().connect(sigc::mem_fun(*this, &QualityGovernor::evaluate), WINDOW_MS);
+}
+
+int QualityGovernor::frame_divisor() const {
+    switch (current) { case Tier::Full: return 1; case Tier::HalfRate: case Tier::CheapAnalysis: return 2; case Tier::LowRate: return 4; default: return 0; }
+}
+
+int QualityGovernor::analysis_stride() const { return current == Tier::CheapAnalysis || current == Tier::LowRate ? 2 : 1; }
+
+const char* QualityGovernor::name(Tier t) {
+    switch (t) {
+        case Tier::Full: return "full";
+        case Tier::HalfRate: return "half-rate";
+        case Tier::CheapAnalysis: return "cheap-analysis";
+        case Tier::LowRate: return "low-rate";
+        case Tier::Static: return "static";
+        default: return "?";
+    }
+}
+
+uint64_t QualityGovernor::used_us() {
+    auto& s = Stats::get(); uint64_t t = 0;
+    for (auto m : {Stats::Metric::Update, Stats::Metric::DrawWindow, Stats::Metric::ReadCallback}) t += s.histogram(m).summary().total_us;
+    return t;
+}
+
+// One tier per window: down as soon as the budget is exceeded, up only after a few calm windows, and never
+// straight back into a tier that overran within RETRY_US. The static tier measures next to nothing, so instead
+// of stepping up on its own load it retries low-rate on a timer (see set_tier).
+bool QualityGovernor::evaluate() {
+    if (!active) { evaluating = false; return false; }
+    gint64 now = g_get_monotonic_time(); uint64_t used = used_us();
+    // A Stats reset over D-Bus restarts the totals
+    uint64_t delta = used >= last_used ? used - last_used : used;
+    current_load = 100.0 * delta / std::max<gint64>(1, now - last_eval); last_used = used; last_eval = now;
+    int t = (int)current;
+    if (current_load > budget() && current != Tier::Static) {
+        exceeded_at[t] = now; calm = 0;
+        if (t + 1 == (int)Tier::Static) static_budget = budget();
+        set_tier((Tier)(t + 1));
+    } else if (current_load < budget() * 0.5 && t > 0 && current != Tier::Static) {
+        if (++calm >= CALM_WINDOWS && (!exceeded_at[t - 1] || now - exceeded_at[t - 1] > RETRY_US)) { calm = 0; set_tier((Tier)(t - 1)); }
+    } else calm = 0;
+    evaluated_sig.emit();
+    return true;
+}
+
+// Static re-enters low-rate on trial every RETRY_US; an overrun in that window sends it straight back
+void QualityGovernor::set_tier(Tier t) {
+    if (t == current) return;
+    Tier from = current; current = t; Stats::get().count(Stats::Counter::TierChange);
+    static_probe.disconnect();
+    if (t == Tier::Static) static_probe = Glib::signal_timeout().connect_seconds(sigc::mem_fun(*this, &QualityGovernor::on_static_probe), RETRY_US / 1000000);
+    tier_sig.emit(from, t);
+}
+
+bool QualityGovernor::on_static_probe() { calm = 0; set_tier(Tier::LowRate); return false; }
+
+void QualityGovernor::on_upower_ready(Glib::RefPtr<Gio::AsyncResult>& r) { try {
+    upower = Gio::DBus::Proxy::create_for_bus_finish(r);
+    Glib::VariantBase v; upower->get_cached_property(v, "OnBattery");
+    if (v && v.is_of_type(Glib::VARIANT_TYPE_BOOL)) on_battery = Glib::VariantBase::cast_dynamic<Glib::Variant<bool>>(v).get();
+    upower->signal_properties_changed().connect(sigc::mem_fun(*this, &QualityGovernor::on_upower_changed));
+} catch(...) {} }
+
+// The lower battery budget takes effect at the next evaluation, so the governor still steps down one tier at a time.
+// A switch to a budget at least as large as the one the static tier was entered under retries low-rate at once.
+void QualityGovernor::on_upower_changed(const Gio::DBus::Proxy::MapChangedProperties& changed, const std::vector<Glib::ustring>&) { try {
+    auto it = changed.find("OnBattery"); if (it == changed.end()) return;
+    bool battery = Glib::VariantBase::cast_dynamic<Glib::Variant<bool>>(it->second).get();
+    if (battery == on_battery) return;
+    on_battery = battery; calm = 0;
+    if (current == Tier::Static && budget() >= static_budget) { exceeded_at[(int)Tier::LowRate] = 0; set_tier(Tier::LowRate); }
+    evaluated_sig.emit();
+} catch(...) {} }
+
+GovernorService::GovernorService(const Glib::RefPtr<Gio::DBus::Connection>& conn, QualityGovernor& governor)
+    : conn(conn), governor(governor), vtable(Gio::DBus::InterfaceVTable::SlotInterfaceMethodCall(), sigc::mem_fun(*this, &GovernorService::on_get_property)),
+      props(snapshot()) {
+    try { registration = conn->register_object("/org/novic/Governor", Gio::DBus::NodeInfo::create_for_xml(GOVERNOR_XML)->lookup_interface("org.novic.Governor"), vtable); } catch(...) {}
+    governor.signal_tier_changed().connect(sigc::mem_fun(*this, &GovernorService::on_tier_changed));
+    governor.signal_evaluated().connect(sigc::mem_fun(*this, &GovernorService::on_evaluated));
+}
+
+GovernorService::~GovernorService() { if (registration) conn->unregister_object(registration); }
+
+GovernorService::PropMap GovernorService::snapshot() const {
+    return {{"Tier", Glib::Variant<Glib::ustring>::create(QualityGovernor::name(governor.tier()))}, {"Budget", Glib::Variant<double>::create(governor.budget())},
+            {"Load", Glib::Variant<double>::create(std::round(governor.load() * 10) / 10)}, {"OnBattery", Glib::Variant<bool>::create(governor.is_on_battery())}};
+}
+
+void GovernorService::on_tier_changed(QualityGovernor::Tier from, QualityGovernor::Tier to) {
+    if (!registration) return;
+    try {
+        conn->emit_signal("/org/novic/Governor", "org.novic.Governor", "TierChanged", {}, Glib::VariantContainerBase::create_tuple({
+            Glib::Variant<Glib::ustring>::create(QualityGovernor::name(from)), Glib::Variant<Glib::ustring>::create(QualityGovernor::name(to)),
+            Glib::Variant<double>::create(governor.load())}));
+    } catch(...) {}
+}
+
+void GovernorService::on_evaluated() {
+    PropMap changed = update_properties(props, snapshot());
+    if (changed.empty() || !registration) return;
+    try { emit_properties_changed(conn, "/org/novic/Governor", "org.novic.Governor", changed); } catch(...) {}
+}
+
+void GovernorService::on_get_property(Glib::VariantBase& property, const Glib::RefPtr<Gio::DBus::Connection>&, const Glib::ustring&, const Glib::ustring&,
+                                      const Glib::ustring&, const Glib::ustring& name) {
+    auto it = props.find(name); if (it != props.end()) property = it->second;
+}
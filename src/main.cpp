@@ -1,130 +1,24 @@
+#include "novic/constants.h"
+#include "novic/audio_visualizer.h"
+#include "novic/broadcast.h"
+#include "novic/governor.h"
+#include "novic/media_monitor.h"
+#include "novic/art_cache.h"
+#include "novic/render.h"
+#include "novic/stats.h"
+#include "novic/trace.h"
 #include <gtkmm.h>
 #include <gtk-layer-shell.h>
-#include <giomm/dbusproxy.h>
-#include <pulse/pulseaudio.h>
 #include <iostream>
 #include <memory>
-#include <sstream>
 #include <cmath>
-#include <array>
-
-constexpr int NUM_BARS = 7;
-constexpr int COLLAPSED_WIDTH = 400;
-constexpr int COLLAPSED_HEIGHT = 60;
-constexpr int EXPANDED_WIDTH = 620;
-constexpr int EXPANDED_HEIGHT = 240;
-
-class AudioVisualizer {
-public:
-    AudioVisualizer() {
-        for (auto& level : levels) level = 0.0f;
-        for (auto& level : smoothed_levels) level = 0.0f;
-        setup_pulseaudio();
-    }
-    ~AudioVisualizer() { cleanup_pulseaudio(); }
-    std::array<float, NUM_BARS> get_levels() const { return smoothed_levels; }
-    void set_playing(bool playing) { is_playing = playing; if (!playing) for (auto& l : levels) l = 0.0f; }
-    void update() {
-        for (int i = 0; i < NUM_BARS; i++) {
-            if (levels[i] > smoothed_levels[i]) smoothed_levels[i] += (levels[i] - smoothed_levels[i]) * 0.4f;
-            else smoothed_levels[i] *= 0.88f;
-            smoothed_levels[i] = std::clamp(smoothed_levels[i], 0.0f, 1.0f);
-            if (smoothed_levels[i] < 0.02f) smoothed_levels[i] = 0.0f;
-        }
-    }
-private:
-    pa_mainloop* mainloop = nullptr; pa_mainloop_api* mainloop_api = nullptr;
-    pa_context* context = nullptr; pa_stream* stream = nullptr;
-    std::array<float, NUM_BARS> levels{}, smoothed_levels{}; bool is_playing = false;
-    void setup_pulseaudio() {
-        mainloop = pa_mainloop_new(); mainloop_api = pa_mainloop_get_api(mainloop);
-        context = pa_context_new(mainloop_api, "Novic");
-        pa_context_set_state_callback(context, ctx_cb, this);
-        pa_context_connect(context, nullptr, PA_CONTEXT_NOFLAGS, nullptr);
-        Glib::signal_timeout().connect([this]() { if (mainloop) pa_mainloop_iterate(mainloop, 0, nullptr); return true; }, 10);
-    }
-    void cleanup_pulseaudio() {
-        if (stream) { pa_stream_disconnect(stream); pa_stream_unref(stream); }
-        if (context) { pa_context_disconnect(context); pa_context_unref(context); }
-        if (mainloop) pa_mainloop_free(mainloop);
-    }
-    static void ctx_cb(pa_context* c, void* u) { if (pa_context_get_state(c) == PA_CONTEXT_READY) static_cast<AudioVisualizer*>(u)->setup_stream(); }
-    void setup_stream() { auto op = pa_context_get_server_info(context, srv_cb, this); if (op) pa_operation_unref(op); }
-    static void srv_cb(pa_context* c, const pa_server_info* i, void* u) {
-        auto* s = static_cast<AudioVisualizer*>(u); if (!i || !i->default_sink_name) return;
-        pa_sample_spec ss = {PA_SAMPLE_FLOAT32LE, 44100, 2};
-        s->stream = pa_stream_new(c, "Novic", &ss, nullptr); if (!s->stream) return;
-        pa_stream_set_read_callback(s->stream, read_cb, u);
-        pa_buffer_attr a = {(uint32_t)-1,(uint32_t)-1,(uint32_t)-1,(uint32_t)-1,4096};
-        pa_stream_connect_record(s->stream, (std::string(i->default_sink_name)+".monitor").c_str(), &a, PA_STREAM_ADJUST_LATENCY);
-    }
-    static void read_cb(pa_stream* s, size_t len, void* u) {
-        auto* self = static_cast<AudioVisualizer*>(u); const void* d;
-        if (pa_stream_peek(s, &d, &len) < 0 || !d) { pa_stream_drop(s); return; }
-        auto* samp = static_cast<const float*>(d); size_t n = len/sizeof(float);
-        for (int i = 0; i < NUM_BARS; i++) {
-            size_t off = (i*n/NUM_BARS)%n, bs = n/NUM_BARS; float r = 0;
-            for (size_t j = 0; j < bs && off+j < n; j++) r += samp[off+j]*samp[off+j];
-            self->levels[i] = std::min(1.0f, std::sqrt(r/bs)*15.0f) * (0.8f + 0.2f*(i%3)/2.0f);
-        }
-        pa_stream_drop(s);
-    }
-};
-
-class MediaMonitor {
-public:
-    struct MediaInfo { std::string title, artist, album, player_name, icon_name, art_url, bus_name; bool is_playing = false; int64_t position = 0, length = 0; };
-    MediaMonitor() { check(); Glib::signal_timeout().connect(sigc::mem_fun(*this, &MediaMonitor::check), 500); }
-    MediaInfo get_current_media() const { return current; }
-    sigc::signal<void(MediaInfo)> signal_media_changed() { return sig; }
-    void play_pause() { cmd("PlayPause"); } void next() { cmd("Next"); } void previous() { cmd("Previous"); }
-private:
-    MediaInfo current; sigc::signal<void(MediaInfo)> sig;
-    void cmd(const std::string& c) { if (current.bus_name.empty()) return; try {
-        Gio::DBus::Connection::get_sync(Gio::DBus::BUS_TYPE_SESSION)->call_sync("/org/mpris/MediaPlayer2","org.mpris.MediaPlayer2.Player",c,{},current.bus_name);
-    } catch(...){} }
-    bool check() { try {
-        auto conn = Gio::DBus::Connection::get_sync(Gio::DBus::BUS_TYPE_SESSION);
-        auto r = conn->call_sync("/org/freedesktop/DBus","org.freedesktop.DBus","ListNames",{},"org.freedesktop.DBus");
-        Glib::Variant<std::vector<Glib::ustring>> nv; r.get_child(nv,0);
-        std::vector<Glib::ustring> players; for (auto& n : nv.get()) if (n.find("org.mpris.MediaPlayer2.")==0) players.push_back(n);
-        MediaInfo play, pause; bool fp=false, hp=false;
-        for (auto& p : players) { auto i = get_info(conn,p); if (i.is_playing) {play=i;fp=true;break;} else if (!hp&&!i.title.empty()) {pause=i;hp=true;} }
-        auto* sel = fp?&play:(hp?&pause:nullptr);
-        if (sel && (current.title!=sel->title||current.is_playing!=sel->is_playing||current.position!=sel->position)) { current=*sel; sig.emit(current); }
-        else if (!sel && !current.title.empty()) { current={}; sig.emit(current); }
-    } catch(...){} return true; }
-    MediaInfo get_info(Glib::RefPtr<Gio::DBus::Connection> c, const Glib::ustring& bus) {
-        MediaInfo i; i.bus_name=bus; i.player_name=bus.substr(23); try {
-            auto get_prop = [&](const std::string& iface, const std::string& prop) {
-                return c->call_sync("/org/mpris/MediaPlayer2","org.freedesktop.DBus.Properties","Get",
-                    Glib::VariantContainerBase::create_tuple({Glib::Variant<Glib::ustring>::create(iface),Glib::Variant<Glib::ustring>::create(prop)}),bus);
-            };
-            Glib::VariantBase v; get_prop("org.mpris.MediaPlayer2.Player","PlaybackStatus").get_child(v,0);
-            try { i.is_playing = Glib::VariantBase::cast_dynamic<Glib::Variant<Glib::ustring>>(v).get()=="Playing"; }
-            catch(...) { i.is_playing = Glib::VariantBase::cast_dynamic<Glib::Variant<Glib::ustring>>(Glib::VariantBase::cast_dynamic<Glib::Variant<Glib::VariantBase>>(v).get()).get()=="Playing"; }
-            try { Glib::VariantBase pv; get_prop("org.mpris.MediaPlayer2.Player","Position").get_child(pv,0);
-                try { i.position = Glib::VariantBase::cast_dynamic<Glib::Variant<int64_t>>(pv).get(); }
-                catch(...) { i.position = Glib::VariantBase::cast_dynamic<Glib::Variant<int64_t>>(Glib::VariantBase::cast_dynamic<Glib::Variant<Glib::VariantBase>>(pv).get()).get(); }
-            } catch(...) {}
-            get_prop("org.mpris.MediaPlayer2.Player","Metadata").get_child(v,0);
-            i.title="Unknown"; i.artist="Unknown"; i.album=""; i.icon_name="multimedia-player";
-            try { auto mi = Glib::VariantBase::cast_dynamic<Glib::Variant<Glib::VariantBase>>(v);
-                auto m = Glib::VariantBase::cast_dynamic<Glib::Variant<std::map<Glib::ustring,Glib::VariantBase>>>(mi.get()).get();
-                if (m.count("xesam:title")) i.title = Glib::VariantBase::cast_dynamic<Glib::Variant<Glib::ustring>>(m["xesam:title"]).get();
-                if (m.count("xesam:album")) i.album = Glib::VariantBase::cast_dynamic<Glib::Variant<Glib::ustring>>(m["xesam:album"]).get();
-                if (m.count("xesam:artist")) { try { auto a = Glib::VariantBase::cast_dynamic<Glib::Variant<std::vector<Glib::ustring>>>(m["xesam:artist"]).get(); if(!a.empty()) i.artist=a[0]; } catch(...) { try { i.artist=Glib::VariantBase::cast_dynamic<Glib::Variant<Glib::ustring>>(m["xesam:artist"]).get(); } catch(...){} } }
-                if (m.count("mpris:artUrl")) try { i.art_url = Glib::VariantBase::cast_dynamic<Glib::Variant<Glib::ustring>>(m["mpris:artUrl"]).get(); } catch(...){}
-                if (m.count("mpris:length")) try { i.length = Glib::VariantBase::cast_dynamic<Glib::Variant<int64_t>>(m["mpris:length"]).get(); } catch(...){}
-            } catch(...) {}
-            if (i.player_name.find("spotify")!=std::string::npos) i.icon_name="spotify";
-        } catch(...) {} return i;
-    }
-};
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
 
 class NovicWindow : public Gtk::Window {
 public:
-    NovicWindow() {
+    explicit NovicWindow(gint64 launched) : launched(launched), startup_trace(std::getenv("NOVIC_STARTUP_TRACE")) {
         set_title("Novic"); set_default_size(COLLAPSED_WIDTH, COLLAPSED_HEIGHT);
         set_decorated(false); set_app_paintable(true);
         add_events(Gdk::ENTER_NOTIFY_MASK | Gdk::LEAVE_NOTIFY_MASK);
@@ -138,7 +32,7 @@ public:
         // Collapsed view
         collapsed_box.set_spacing(10); collapsed_box.set_margin_top(10); collapsed_box.set_margin_bottom(10);
         collapsed_box.set_margin_start(20); collapsed_box.set_margin_end(20);
-        icon.set_pixel_size(32); collapsed_box.pack_start(icon, false, false, 0);
+        icon.set_pixel_size(ICON_SIZE); collapsed_box.pack_start(icon, false, false, 0);
         label.set_text("🚀 Novic"); collapsed_box.pack_start(label, false, false, 0);
         visualizer_area.set_size_request(120, 36);
         visualizer_area.signal_draw().connect(sigc::mem_fun(*this, &NovicWindow::on_viz_draw));
@@ -152,7 +46,7 @@ public:
         
         // Top row: Album art + Info + Visualizer
         top_row.set_spacing(20);
-        album_art_area.set_size_request(90, 90);
+        album_art_area.set_size_request(ALBUM_ART_SIZE, ALBUM_ART_SIZE);
         album_art_area.signal_draw().connect(sigc::mem_fun(*this, &NovicWindow::on_album_draw));
         top_row.pack_start(album_art_area, false, false, 0);
         
@@ -208,18 +102,15 @@ public:
         add(main_vbox); show_all_children();
         icon.hide(); visualizer_area.hide(); expanded_box.hide();
         
-        media_monitor = std::make_unique<MediaMonitor>();
-        media_monitor->signal_media_changed().connect(sigc::mem_fun(*this, &NovicWindow::on_media_changed));
-        audio_visualizer = std::make_unique<AudioVisualizer>();
-        Glib::signal_timeout().connect([this]() { 
-            audio_visualizer->update(); 
-            if (is_playing) { 
-                visualizer_area.queue_draw(); 
-                expanded_viz_area.queue_draw();
-                progress_area.queue_draw(); 
-            } 
-            return true; 
-        }, 16);
+        art_cache.signal_ready().connect(sigc::mem_fun(*this, &NovicWindow::on_art_ready));
+        if (auto* e = std::getenv("NOVIC_BARS")) bars = std::clamp(std::atoi(e), 1, SpectrumAnalyzer::MAX_BARS);
+        expanded_viz_area.set_size_request(std::max(80, bars * 8 + 4), 80);
+        idle_levels.assign(bars, 0.0f);
+        for (int i = 0; i < bars; i++) static_levels.push_back(0.3f + 0.4f * (0.5f + 0.5f * std::sin(i * 1.7f)));
+        if (auto* e = std::getenv("NOVIC_STATS_INTERVAL")) if (int s = std::atoi(e); s > 0) {
+            Glib::signal_timeout().connect_seconds([]() { std::cerr << Stats::get().format() << std::endl; return true; }, s);
+            stats_interval = true; arm_stall_probe();
+        }
         
         auto css = Gtk::CssProvider::create();
         css->load_from_data(
@@ -232,6 +123,8 @@ public:
         time_current.get_style_context()->add_class("time-label");
         time_remaining.get_style_context()->add_class("time-label");
     }
+    // NOVIC_STARTUP_TRACE reports startup milestones relative to entering main()
+    void startup_mark(const char* what) { if (startup_trace) std::cerr << "novic: " << what << " after " << (g_get_monotonic_time() - launched) / 1000.0 << " ms" << std::endl; }
 
 protected:
     bool on_enter_notify_event(GdkEventCrossing* e) override {
@@ -253,115 +146,209 @@ protected:
         return false;
     }
     bool on_draw(const Cairo::RefPtr<Cairo::Context>& cr) override {
-        auto a = get_allocation(); double w = a.get_width(), h = a.get_height(), r = 25.0;
-        cr->move_to(0, 0); cr->line_to(w, 0); cr->line_to(w, h - r);
-        cr->arc(w - r, h - r, r, 0, M_PI / 2); cr->arc(r, h - r, r, M_PI / 2, M_PI); cr->close_path();
-        cr->set_source_rgba(0.043, 0.047, 0.047, 0.98); cr->fill();
-        return Gtk::Window::on_draw(cr);
+        ScopedTimer timer(Stats::Metric::DrawWindow);
+        auto a = get_allocation(); background.draw(cr, a.get_width(), a.get_height(), get_scale_factor());
+        bool r = Gtk::Window::on_draw(cr);
+        if (!services_started) {
+            services_started = true; startup_mark("first frame");
+            Glib::signal_idle().connect_once(sigc::mem_fun(*this, &NovicWindow::start_services));
+        }
+        return r;
     }
     bool on_viz_draw(const Cairo::RefPtr<Cairo::Context>& cr) {
-        auto a = visualizer_area.get_allocation(); double w = a.get_width(), h = a.get_height();
-        auto levels = audio_visualizer->get_levels();
-        double bw = 3, bs = 3, tw = NUM_BARS * bw + (NUM_BARS - 1) * bs, sx = w - tw - 4, mh = h * 0.9, cy = h / 2;
-        for (int i = 0; i < NUM_BARS; i++) {
-            double bh = 3 + (mh - 3) * levels[i], x = sx + i * (bw + bs), y = cy - bh / 2, rad = bw / 2;
-            cr->arc(x + rad, y + rad, rad, M_PI, 3 * M_PI / 2); cr->arc(x + bw - rad, y + rad, rad, 3 * M_PI / 2, 0);
-            cr->arc(x + bw - rad, y + bh - rad, rad, 0, M_PI / 2); cr->arc(x + rad, y + bh - rad, rad, M_PI / 2, M_PI);
-            cr->close_path(); cr->set_source_rgb(1, 1, 1); cr->fill();
-        }
-        return true;
+        if (!audio_visualizer) return true;
+        ScopedTimer timer(Stats::Metric::DrawViz);
+        auto a = visualizer_area.get_allocation();
+        draw_collapsed_bars(cr, collapsed_bars, bar_levels(), a.get_width(), a.get_height(), get_scale_factor());
+        record_audio_latency(); return true;
     }
     bool on_expanded_viz_draw(const Cairo::RefPtr<Cairo::Context>& cr) {
-        auto a = expanded_viz_area.get_allocation(); double w = a.get_width(), h = a.get_height();
-        auto levels = audio_visualizer->get_levels();
-        double bw = 4, bs = 4, tw = NUM_BARS * bw + (NUM_BARS - 1) * bs;
-        double sx = (w - tw) / 2, mh = h * 0.85, cy = h / 2;
-        for (int i = 0; i < NUM_BARS; i++) {
-            double bh = 4 + (mh - 4) * levels[i], x = sx + i * (bw + bs), y = cy - bh / 2, rad = bw / 2;
-            cr->arc(x + rad, y + rad, rad, M_PI, 3 * M_PI / 2); cr->arc(x + bw - rad, y + rad, rad, 3 * M_PI / 2, 0);
-            cr->arc(x + bw - rad, y + bh - rad, rad, 0, M_PI / 2); cr->arc(x + rad, y + bh - rad, rad, M_PI / 2, M_PI);
-            cr->close_path(); cr->set_source_rgb(1, 1, 1); cr->fill();
-        }
-        return true;
+        if (!audio_visualizer) return true;
+        ScopedTimer timer(Stats::Metric::DrawExpandedViz);
+        auto a = expanded_viz_area.get_allocation();
+        draw_expanded_bars(cr, expanded_bars, bar_levels(), a.get_width(), a.get_height(), get_scale_factor());
+        record_audio_latency(); return true;
     }
     bool on_album_draw(const Cairo::RefPtr<Cairo::Context>& cr) {
-        if (!album_pixbuf) return true;
-        double s = 90, r = 10;
-        cr->arc(r, r, r, M_PI, 3*M_PI/2); cr->arc(s-r, r, r, 3*M_PI/2, 0);
-        cr->arc(s-r, s-r, r, 0, M_PI/2); cr->arc(r, s-r, r, M_PI/2, M_PI); cr->close_path(); cr->clip();
-        Gdk::Cairo::set_source_pixbuf(cr, album_pixbuf, 0, 0); cr->paint();
+        if (!album_surface) return true;
+        ScopedTimer timer(Stats::Metric::DrawAlbumArt);
+        cr->set_source(album_surface, 0, 0); cr->paint();
         return true;
     }
     bool on_progress_draw(const Cairo::RefPtr<Cairo::Context>& cr) {
-        auto a = progress_area.get_allocation(); double w = a.get_width(), h = a.get_height();
-        double progress = (current_info.length > 0) ? (double)current_info.position / current_info.length : 0;
-        progress = std::clamp(progress, 0.0, 1.0);
-        cr->arc(h/2, h/2, h/2, M_PI/2, 3*M_PI/2); cr->arc(w-h/2, h/2, h/2, 3*M_PI/2, M_PI/2); cr->close_path();
-        cr->set_source_rgb(0.2, 0.2, 0.2); cr->fill();
-        double pw = std::max(h, w * progress);
-        cr->arc(h/2, h/2, h/2, M_PI/2, 3*M_PI/2); cr->arc(pw-h/2, h/2, h/2, 3*M_PI/2, M_PI/2); cr->close_path();
-        cr->set_source_rgb(0.5, 0.5, 0.5); cr->fill();
+        ScopedTimer timer(Stats::Metric::DrawProgress);
+        auto a = progress_area.get_allocation();
+        draw_progress(cr, a.get_width(), a.get_height(), current_info.length > 0 ? (double)display_position / current_info.length : 0);
         return true;
     }
-    void on_media_changed(MediaMonitor::MediaInfo info) {
-        current_info = info; is_playing = info.is_playing;
+    void on_metadata_changed(MediaMonitor::MediaInfo info) {
+        current_info = info;
         has_media = !info.title.empty() && info.title != "Unknown";
-        audio_visualizer->set_playing(info.is_playing);
         if (has_media) {
             title_label.set_markup("<span font_weight='bold' font_size='x-large' foreground='white'>" + Glib::Markup::escape_text(info.title) + "</span>");
             std::string sub = info.artist;
             if (!info.album.empty() && info.album != "Unknown") sub += " • " + info.album;
             artist_label.set_markup("<span foreground='#888888'>" + Glib::Markup::escape_text(sub) + "</span>");
-            play_btn.set_label(info.is_playing ? "⏸" : "▶");
-            auto fmt = [](int64_t us) { int s = us / 1000000; int m = s / 60; s %= 60; char b[16]; snprintf(b, 16, "%d:%02d", m, s); return std::string(b); };
-            time_current.set_text(fmt(info.position));
-            if (info.length > 0) time_remaining.set_text("-" + fmt(info.length - info.position));
-            load_album_art(info.art_url);
-            if (!info.art_url.empty()) load_icon(info.art_url, 32);
-            else load_app_icon(info.icon_name, info.player_name);
+            if (info.art_url != shown_art_url || !icon.is_visible()) show_art(info.art_url);
             label.hide(); visualizer_area.show();
+            if (!had_media) { had_media = true; startup_mark("first media"); }
         } else {
             icon.hide(); visualizer_area.hide(); label.set_text("🚀 Novic"); label.show();
             if (is_expanded) { is_expanded = false; expanded_box.hide(); collapsed_box.show(); resize(COLLAPSED_WIDTH, COLLAPSED_HEIGHT); }
         }
     }
+    void on_status_changed(MediaMonitor::MediaInfo info) {
+        current_info = info; is_playing = info.is_playing;
+        audio_visualizer->set_playing(info.is_playing && !is_static());
+        play_btn.set_label(info.is_playing ? "⏸" : "▶");
+        if (is_static()) queue_bar_draws(); else if (info.is_playing) start_animation();
+        update_governor(); update_position_timer();
+    }
+    void on_position_changed(MediaMonitor::MediaInfo info) { current_info = info; shown_second = -1; update_position(g_get_monotonic_time()); }
+    // Extrapolates the position locally; labels change once per second and the bar only when it gains a pixel
+    void update_position(gint64 now) {
+        if (!has_media) return;
+        display_position = current_info.position_at(now);
+        int sec = display_position / 1000000;
+        if (sec != shown_second) {
+            auto fmt = [](int64_t us) { int s = us / 1000000; int m = s / 60; s %= 60; char b[16]; snprintf(b, 16, "%d:%02d", m, s); return std::string(b); };
+            shown_second = sec; time_current.set_text(fmt(display_position));
+            if (current_info.length > 0) time_remaining.set_text("-" + fmt(current_info.length - display_position));
+        }
+        int px = current_info.length > 0 ? (int)(progress_area.get_allocated_width() * (double)display_position / current_info.length) : 0;
+        if (px != shown_progress_px && progress_area.is_drawable()) { shown_progress_px = px; progress_area.queue_draw(); }
+    }
 private:
     Gtk::Box main_vbox{Gtk::ORIENTATION_VERTICAL}, expanded_box, text_box;
     Gtk::HBox collapsed_box, top_row, controls_box, progress_box;
     Gtk::Image icon; Gtk::Label label, title_label, artist_label, time_current, time_remaining;
     Gtk::Button prev_btn, play_btn, next_btn;
     Gtk::DrawingArea visualizer_area, album_art_area, progress_area, expanded_viz_area;
-    Glib::RefPtr<Gdk::Pixbuf> album_pixbuf;
-    std::unique_ptr<MediaMonitor> media_monitor; std::unique_ptr<AudioVisualizer> audio_visualizer;
+    Cairo::RefPtr<Cairo::ImageSurface> album_surface; ArtCache art_cache; std::string shown_art_url;
+    BackgroundCache background; BarSprite collapsed_bars, expanded_bars;
+    const gint64 launched; const bool startup_trace; bool services_started = false, had_media = false, broadcast = true; int bars = NUM_BARS;
+    std::unique_ptr<StatsService> stats_service; gint64 last_probe = 0, last_tick = 0, shown_audio_time = 0; bool stats_interval = false;
+    // The trace and the ring are written from the capture thread, so they are declared before (and outlive) the visualizer
+    std::unique_ptr<TraceWriter> trace; std::unique_ptr<SpectrumRingWriter> spectrum_ring;
+    std::unique_ptr<MediaMonitor> media_monitor; std::unique_ptr<AudioVisualizer> audio_visualizer; std::unique_ptr<NowPlayingService> now_playing;
+    std::unique_ptr<QualityGovernor> governor; std::unique_ptr<GovernorService> governor_service;
+    std::vector<float> static_levels, idle_levels; unsigned tick_count = 0;
     MediaMonitor::MediaInfo current_info; bool is_playing = false, is_expanded = false, has_media = false;
-    
-    void load_album_art(const std::string& url) {
-        try {
-            Glib::RefPtr<Gdk::Pixbuf> pb;
-            if (url.find("file://") == 0) {
-                std::string p = url.substr(7), d;
-                for (size_t i = 0; i < p.length(); i++) { if (p[i] == '%' && i+2 < p.length()) { int v; std::stringstream ss; ss << std::hex << p.substr(i+1,2); ss >> v; d += (char)v; i += 2; } else d += p[i]; }
-                pb = Gdk::Pixbuf::create_from_file(d, 90, 90, true);
-            } else if (url.find("http") == 0) {
-                pb = Gdk::Pixbuf::create_from_stream(Gio::File::create_for_uri(url)->read());
-                if (pb) pb = pb->scale_simple(90, 90, Gdk::INTERP_BILINEAR);
-            }
-            if (pb) { album_pixbuf = pb; album_art_area.queue_draw(); }
-        } catch (...) { album_pixbuf.reset(); }
+    guint tick_id = 0; sigc::connection position_timer; gint64 last_frame_time = 0, display_position = 0; int shown_second = -1, shown_progress_px = -1;
+
+    // Everything that talks to the sound server or the icon theme, and everything on the session bus beyond
+    // Gtk::Application's own registration, waits until the collapsed bar is on screen. Registration still
+    // blocks before the window maps; the "registered" startup mark shows what it costs.
+    void start_services() {
+        if (auto* e = std::getenv("NOVIC_RECORD")) { trace = std::make_unique<TraceWriter>(e); if (!trace->is_open()) { std::cerr << "novic: cannot record to " << e << "\n"; trace.reset(); } }
+        CaptureConfig capture;
+        if (auto* e = std::getenv("NOVIC_CAPTURE_RATE")) capture.rate = std::clamp(std::atoi(e), 8000, 96000);
+        if (auto* e = std::getenv("NOVIC_CAPTURE_LATENCY_MS")) capture.latency_ms = std::clamp(std::atof(e), 2.0, 200.0);
+        if (auto m = get_display()->get_monitor_at_window(get_window())) if (m->get_refresh_rate() > 0) capture.refresh_hz = m->get_refresh_rate() / 1000.0;
+        // Other desktop components read the spectrum and track state from here instead of capturing their own
+        if (auto* e = std::getenv("NOVIC_BROADCAST"); e && std::string(e) == "0") broadcast = false;
+        if (broadcast) {
+            spectrum_ring = std::make_unique<SpectrumRingWriter>(); if (!spectrum_ring->is_open()) spectrum_ring.reset();
+        }
+        audio_visualizer = std::make_unique<AudioVisualizer>(bars, capture, true, trace.get(), spectrum_ring.get());
+        QualityGovernor::Config quality;
+        if (auto* e = std::getenv("NOVIC_CPU_BUDGET")) quality.budget = std::max(0.01, std::atof(e));
+        quality.battery_budget = quality.budget / 4;
+        if (auto* e = std::getenv("NOVIC_BATTERY_BUDGET")) quality.battery_budget = std::max(0.01, std::atof(e));
+        quality.upower_session_bus = std::getenv("NOVIC_UPOWER_BUS") && std::string(std::getenv("NOVIC_UPOWER_BUS")) == "session";
+        governor = std::make_unique<QualityGovernor>(quality);
+        governor->signal_tier_changed().connect(sigc::mem_fun(*this, &NovicWindow::on_tier_changed));
+        media_monitor = std::make_unique<MediaMonitor>(); media_monitor->set_trace(trace.get());
+        media_monitor->signal_metadata_changed().connect(sigc::mem_fun(*this, &NovicWindow::on_metadata_changed));
+        media_monitor->signal_status_changed().connect(sigc::mem_fun(*this, &NovicWindow::on_status_changed));
+        media_monitor->signal_position_changed().connect(sigc::mem_fun(*this, &NovicWindow::on_position_changed));
+        Gio::DBus::Connection::get(Gio::DBus::BUS_TYPE_SESSION, sigc::mem_fun(*this, &NovicWindow::on_bus_ready));
+        // Loads the icon theme index ahead of the first player icon
+        Glib::signal_idle().connect_once([]() { Gtk::IconTheme::get_default()->has_icon("multimedia-player"); }, Glib::PRIORITY_LOW);
+        startup_mark("services started");
+    }
+    void on_bus_ready(Glib::RefPtr<Gio::AsyncResult>& r) { try {
+        auto conn = Gio::DBus::Connection::get_finish(r);
+        stats_service = std::make_unique<StatsService>(conn);
+        governor_service = std::make_unique<GovernorService>(conn, *governor);
+        // Track state is still worth exporting when /dev/shm is unavailable; SpectrumRing is then empty
+        if (broadcast) now_playing = std::make_unique<NowPlayingService>(conn, *media_monitor, spectrum_ring ? spectrum_ring->name() : std::string());
+    } catch(...) {} }
+
+    // Stalls are how late the main loop ran a short timer, measured only while animating (or while
+    // NOVIC_STATS_INTERVAL is dumping them) so an idle bar never wakes up to probe itself
+    static constexpr int STALL_PROBE_MS = 100;
+    void arm_stall_probe() {
+        if (last_probe) return;
+        last_probe = g_get_monotonic_time();
+        Glib::signal_timeout().connect(sigc::mem_fun(*this, &NovicWindow::on_stall_probe), STALL_PROBE_MS);
+    }
+    bool on_stall_probe() {
+        gint64 now = g_get_monotonic_time(); Stats::get().record(Stats::Metric::MainLoopStall, std::max<gint64>(0, now - last_probe - STALL_PROBE_MS * 1000));
+        if (tick_id || stats_interval) { last_probe = now; return true; }
+        last_probe = 0; return false;
+    }
+    // Frames the clock skipped while the animation was attached, beyond one refresh interval
+    void record_frame_gap(const Glib::RefPtr<Gdk::FrameClock>& clock, gint64 now) {
+        gint64 interval = 0, presentation = 0; gdk_frame_clock_get_refresh_info(clock->gobj(), now, &interval, &presentation);
+        if (last_tick && interval > 0) Stats::get().record(Stats::Metric::MainLoopStall, std::max<gint64>(0, now - last_tick - interval));
+        last_tick = now;
+    }
+    // Counted once per analysed frame, when it first reaches the screen
+    void record_audio_latency() {
+        gint64 t = audio_visualizer->frame_time(); if (!t || t == shown_audio_time) return;
+        shown_audio_time = t; Stats::get().record(Stats::Metric::AudioToScreen, g_get_monotonic_time() - t);
+    }
+
+    // Animation follows the compositor's frame clock and detaches once playback stops and the bars have settled
+    void start_animation() { if (!tick_id) { tick_id = add_tick_callback(sigc::mem_fun(*this, &NovicWindow::on_tick)); arm_stall_probe(); update_governor(); } }
+    bool on_tick(const Glib::RefPtr<Gdk::FrameClock>& clock) {
+        record_frame_gap(clock, clock->get_frame_time());
+        // Lower quality tiers handle one tick in frame_divisor(); dt then spans the skipped ones
+        if (int div = governor ? governor->frame_divisor() : 1; div > 1 && ++tick_count % div) return true;
+        gint64 now = clock->get_frame_time(); double dt = last_frame_time ? (now - last_frame_time) / 1000.0 : 16.67; last_frame_time = now;
+        if (is_playing) update_position(now);
+        bool moved; { ScopedTimer timer(Stats::Metric::Update); moved = audio_visualizer->update(dt); }
+        if (moved) queue_bar_draws();
+        if (!is_playing && audio_visualizer->is_idle()) { tick_id = 0; last_frame_time = last_tick = 0; update_governor(); return false; }
+        return true;
+    }
+    // The governor measures only while the frame clock or capture is running
+    void update_governor() { governor->set_active(tick_id || (is_playing && !is_static())); }
+    // Without the frame clock the static tier still advances the time labels and progress bar once a second
+    void update_position_timer() {
+        bool wanted = is_static() && is_playing;
+        if (wanted && !position_timer.connected()) position_timer = Glib::signal_timeout().connect_seconds(sigc::mem_fun(*this, &NovicWindow::on_position_timer), 1);
+        else if (!wanted) position_timer.disconnect();
+    }
+    bool on_position_timer() { update_position(g_get_monotonic_time()); return true; }
+    bool is_static() const { return governor && governor->frame_divisor() == 0; }
+    const std::vector<float>& bar_levels() const { return !is_static() ? audio_visualizer->get_levels() : is_playing ? static_levels : idle_levels; }
+    void queue_bar_draws() {
+        if (visualizer_area.is_drawable()) visualizer_area.queue_draw();
+        if (expanded_viz_area.is_drawable()) expanded_viz_area.queue_draw();
+    }
+    // The static tier stops the frame clock and corks capture; every other tier only changes rates
+    void on_tier_changed(QualityGovernor::Tier, QualityGovernor::Tier) {
+        audio_visualizer->set_analysis_stride(governor->analysis_stride());
+        if (is_static()) {
+            if (tick_id) { remove_tick_callback(tick_id); tick_id = 0; last_frame_time = last_tick = 0; }
+            audio_visualizer->set_playing(false);
+        } else {
+            audio_visualizer->set_playing(is_playing); if (is_playing) start_animation();
+        }
+        update_governor(); update_position_timer(); queue_bar_draws();
+    }
+    void show_art(const std::string& url) {
+        shown_art_url = url;
+        if (url.empty()) { album_surface = Cairo::RefPtr<Cairo::ImageSurface>(); album_art_area.queue_draw(); load_app_icon(current_info.icon_name, current_info.player_name); return; }
+        if (auto* a = art_cache.lookup(url)) { Stats::get().count(Stats::Counter::ArtMemoryHit); apply_art(*a); } else art_cache.request(url);
     }
-    void load_icon(const std::string& url, int size) {
-        try {
-            Glib::RefPtr<Gdk::Pixbuf> pb;
-            if (url.find("file://") == 0) {
-                std::string p = url.substr(7), d;
-                for (size_t i = 0; i < p.length(); i++) { if (p[i] == '%' && i+2 < p.length()) { int v; std::stringstream ss; ss << std::hex << p.substr(i+1,2); ss >> v; d += (char)v; i += 2; } else d += p[i]; }
-                pb = Gdk::Pixbuf::create_from_file(d, size, size, true);
-            } else if (url.find("http") == 0) {
-                pb = Gdk::Pixbuf::create_from_stream(Gio::File::create_for_uri(url)->read());
-                if (pb) pb = pb->scale_simple(size, size, Gdk::INTERP_BILINEAR);
-            }
-            if (pb) { icon.set(pb); icon.show(); }
-        } catch (...) {}
+    // A failed load falls back to the player icon
+    void on_art_ready(const std::string& url) { if (url != shown_art_url) return; if (auto* a = art_cache.lookup(url)) apply_art(*a); else apply_art({}); }
+    void apply_art(const ArtCache::Art& a) {
+        album_surface = a.large; album_art_area.queue_draw();
+        if (a.small) { icon.set(a.small); icon.show(); } else load_app_icon(current_info.icon_name, current_info.player_name);
     }
     void load_app_icon(const std::string& name, const std::string& player) {
         auto t = Gtk::IconTheme::get_default();
@@ -371,6 +358,10 @@ private:
 };
 
 int main(int argc, char* argv[]) {
+    gint64 launched = g_get_monotonic_time();
     auto app = Gtk::Application::create(argc, argv, "com.novic.app");
-    NovicWindow w; return app->run(w);
+    NovicWindow w(launched);
+    // run() registers com.novic.app on the session bus synchronously; startup fires once that has returned
+    app->signal_startup().connect([&w]() { w.startup_mark("registered"); });
+    return app->run(w);
 }
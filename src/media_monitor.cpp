@@ -0,0 +1,233 @@
+#include "novic/media_monitor.h"
+
+namespace {
+
+template <typename T> bool unbox(Glib::VariantBase v, T& out) {
+    try { if (v.is_of_type(Glib::VARIANT_TYPE_VARIANT)) v = Glib::VariantBase::cast_dynamic<Glib::Variant<Glib::VariantBase>>(v).get();
+          out = Glib::VariantBase::cast_dynamic<Glib::Variant<T>>(v).get(); return true; } catch(...) { return false; }
+}
+bool is_playing(const Glib::VariantBase& status) { Glib::ustring s; return status && unbox(status, s) && s == "Playing"; }
+// Identifies the track behind a Metadata value; players resend Metadata for art or length updates mid-track
+std::string track_key(const Glib::VariantBase& metadata) {
+    std::map<Glib::ustring, Glib::VariantBase> m; Glib::ustring id, title;
+    if (!metadata || !unbox(metadata, m)) return {};
+    if (m.count("mpris:trackid")) unbox(m["mpris:trackid"], id);
+    if (m.count("xesam:title")) unbox(m["xesam:title"], title);
+    return id + '\n' + title;
+}
+
+}
+
+// The bus is fetched asynchronously so construction never waits on a session bus that is still starting
+MediaMonitor::MediaMonitor() { Gio::DBus::Connection::get(Gio::DBus::BUS_TYPE_SESSION, sigc::mem_fun(*this, &MediaMonitor::on_bus_ready)); }
+
+void MediaMonitor::on_bus_ready(Glib::RefPtr<Gio::AsyncResult>& r) {
+    try {
+        conn = Gio::DBus::Connection::get_finish(r);
+        // Player appearance/disappearance is pushed by the bus; no ListNames polling
+        name_watch = conn->signal_subscribe(sigc::mem_fun(*this, &MediaMonitor::on_name_owner_changed),
+            "org.freedesktop.DBus", "org.freedesktop.DBus", "NameOwnerChanged", "/org/freedesktop/DBus",
+            "org.mpris.MediaPlayer2", Gio::DBus::SIGNAL_FLAGS_MATCH_ARG0_NAMESPACE);
+        conn->call("/org/freedesktop/DBus", "org.freedesktop.DBus", "ListNames", {},
+            sigc::bind(sigc::mem_fun(*this, &MediaMonitor::on_list_names), g_get_monotonic_time()), "org.freedesktop.DBus");
+    } catch(...) {}
+}
+
+MediaMonitor::~MediaMonitor() { if (conn && name_watch) conn->signal_unsubscribe(name_watch); }
+
+void MediaMonitor::play_pause() {
+    auto it = players.find(current.bus_name); if (it == players.end() || !it->second.proxy) return;
+    // A second press supersedes the first, so the first reply no longer decides anything
+    if (toggle_cancel) toggle_cancel->cancel();
+    toggle_grace.disconnect(); toggle_confirmed = false;
+    auto cancel = toggle_cancel = Gio::Cancellable::create(); toggle_target = it->first;
+    conn->call("/org/mpris/MediaPlayer2", "org.mpris.MediaPlayer2.Player", "PlayPause", {},
+        sigc::bind(sigc::mem_fun(*this, &MediaMonitor::on_toggle_done), cancel, it->first, g_get_monotonic_time()), cancel, it->first, COMMAND_TIMEOUT_MS);
+    auto& p = it->second; gint64 now = g_get_monotonic_time();
+    if (p.playing) p.position += (int64_t)((now - p.position_time) * p.rate);
+    p.position_time = now; p.playing = !p.playing;
+    refresh();
+}
+
+// The player's PlaybackStatus PropertiesChanged is the confirmation. Many players reply to PlayPause before
+// they update it, so only a player that stays silent for TOGGLE_GRACE_MS after replying is asked, once, with a
+// Get; on failure the optimistic state falls back to what the player last reported
+void MediaMonitor::on_toggle_done(Glib::RefPtr<Gio::AsyncResult>& r, Glib::RefPtr<Gio::Cancellable> cancel, Glib::ustring name, gint64 sent) {
+    if (cancel->is_cancelled()) return;
+    auto it = players.find(name); if (it == players.end() || !it->second.proxy) return;
+    try {
+        conn->call_finish(r); Stats::get().record(Stats::Metric::DbusRoundTrip, g_get_monotonic_time() - sent);
+        if (!toggle_confirmed) toggle_grace = Glib::signal_timeout().connect(sigc::bind(sigc::mem_fun(*this, &MediaMonitor::on_toggle_grace), cancel, name), TOGGLE_GRACE_MS);
+        return;
+    } catch(...) {}
+    Glib::VariantBase v; it->second.proxy->get_cached_property(v, "PlaybackStatus"); reconcile_playing(name, v);
+}
+
+bool MediaMonitor::on_toggle_grace(Glib::RefPtr<Gio::Cancellable> cancel, Glib::ustring name) {
+    if (cancel->is_cancelled() || toggle_confirmed) return false;
+    auto it = players.find(name); if (it == players.end() || !it->second.proxy) return false;
+    it->second.proxy->call("org.freedesktop.DBus.Properties.Get",
+        sigc::bind(sigc::mem_fun(*this, &MediaMonitor::on_toggle_status), cancel, name, g_get_monotonic_time()), cancel,
+        Glib::VariantContainerBase::create_tuple({Glib::Variant<Glib::ustring>::create("org.mpris.MediaPlayer2.Player"), Glib::Variant<Glib::ustring>::create("PlaybackStatus")}));
+    return false;
+}
+
+void MediaMonitor::on_toggle_status(Glib::RefPtr<Gio::AsyncResult>& r, Glib::RefPtr<Gio::Cancellable> cancel, Glib::ustring name, gint64 sent) { try {
+    if (cancel->is_cancelled()) return;
+    auto it = players.find(name); if (it == players.end() || !it->second.proxy) return;
+    Glib::VariantBase v; it->second.proxy->call_finish(r).get_child(v, 0);
+    Stats::get().record(Stats::Metric::DbusRoundTrip, g_get_monotonic_time() - sent);
+    reconcile_playing(name, v);
+} catch(...){} }
+
+void MediaMonitor::reconcile_playing(const Glib::ustring& name, const Glib::VariantBase& status) {
+    auto it = players.find(name); if (it == players.end() || !status) return;
+    auto& p = it->second; if (is_playing(status) == p.playing) return;
+    p.playing = !p.playing; p.position_time = g_get_monotonic_time(); fetch_position(name); refresh();
+}
+
+// MPRIS has no multi-step skip, so presses are netted (next + previous cancel out) and sent one at a time
+void MediaMonitor::skip(int n) {
+    if (current.bus_name.empty() || !conn) return;
+    // Presses netted for a player that is no longer shown are dropped rather than sent to the new one
+    if (skip_target != current.bus_name) { pending_skip = 0; skip_target = current.bus_name; }
+    pending_skip += n; send_skip();
+}
+
+void MediaMonitor::send_skip() {
+    if (skipping || !pending_skip || skip_target.empty()) return;
+    bool forward = pending_skip > 0; pending_skip += forward ? -1 : 1; skipping = true;
+    auto cancel = skip_cancel = Gio::Cancellable::create();
+    conn->call("/org/mpris/MediaPlayer2", "org.mpris.MediaPlayer2.Player", forward ? "Next" : "Previous", {},
+        sigc::bind(sigc::mem_fun(*this, &MediaMonitor::on_skip_done), cancel, g_get_monotonic_time()), cancel, skip_target, COMMAND_TIMEOUT_MS);
+}
+
+void MediaMonitor::on_skip_done(Glib::RefPtr<Gio::AsyncResult>& r, Glib::RefPtr<Gio::Cancellable> cancel, gint64 sent) {
+    if (cancel->is_cancelled()) return;
+    try { conn->call_finish(r); Stats::get().record(Stats::Metric::DbusRoundTrip, g_get_monotonic_time() - sent); } catch(...) { pending_skip = 0; }
+    skipping = false; send_skip();
+}
+
+// Only commands aimed at a player that left the bus are dropped; an optimistic pause that switches the shown
+// player must still hear back from the one it paused
+void MediaMonitor::cancel_commands(const Glib::ustring& vanished) {
+    if (toggle_target == vanished) { if (toggle_cancel) toggle_cancel->cancel(); toggle_cancel.reset(); toggle_grace.disconnect(); toggle_target.clear(); }
+    if (skip_target == vanished) { if (skip_cancel) skip_cancel->cancel(); skip_cancel.reset(); skip_target.clear(); pending_skip = 0; skipping = false; }
+}
+
+void MediaMonitor::on_list_names(Glib::RefPtr<Gio::AsyncResult>& r, gint64 sent) { try {
+    Glib::Variant<std::vector<Glib::ustring>> nv; conn->call_finish(r).get_child(nv, 0);
+    Stats::get().record(Stats::Metric::DbusRoundTrip, g_get_monotonic_time() - sent);
+    for (auto& n : nv.get()) if (n.find(MPRIS_PREFIX) == 0) add_player(n);
+} catch(...){} }
+
+void MediaMonitor::on_name_owner_changed(const Glib::RefPtr<Gio::DBus::Connection>&, const Glib::ustring&, const Glib::ustring&,
+                                         const Glib::ustring&, const Glib::ustring&, const Glib::VariantContainerBase& params) { try {
+    Glib::Variant<Glib::ustring> name, new_owner; params.get_child(name, 0); params.get_child(new_owner, 2);
+    if (name.get().find(MPRIS_PREFIX) != 0) return;
+    if (new_owner.get().empty()) { if (players.erase(name.get())) record(TraceKind::PlayerVanished, name.get()); cancel_commands(name.get()); refresh(); }
+    else add_player(name.get());
+} catch(...){} }
+
+void MediaMonitor::add_player(const Glib::ustring& name) {
+    if (players.count(name)) return;
+    players[name] = {};
+    // Proxy construction does a single GetAll and then keeps the cache current from PropertiesChanged
+    Gio::DBus::Proxy::create(conn, name, "/org/mpris/MediaPlayer2", "org.mpris.MediaPlayer2.Player",
+        sigc::bind(sigc::mem_fun(*this, &MediaMonitor::on_proxy_ready), name, g_get_monotonic_time()), Glib::RefPtr<Gio::DBus::InterfaceInfo>(), Gio::DBus::PROXY_FLAGS_DO_NOT_AUTO_START);
+}
+
+void MediaMonitor::on_proxy_ready(Glib::RefPtr<Gio::AsyncResult>& r, Glib::ustring name, gint64 sent) { try {
+    auto proxy = Gio::DBus::Proxy::create_finish(r);
+    Stats::get().record(Stats::Metric::DbusRoundTrip, g_get_monotonic_time() - sent);
+    auto it = players.find(name); if (it == players.end() || it->second.proxy) return;
+    auto& p = it->second; p.proxy = proxy;
+    if (trace) {
+        std::map<Glib::ustring, Glib::VariantBase> props; Glib::VariantBase v;
+        for (auto& n : proxy->get_cached_property_names()) { proxy->get_cached_property(v, n); if (v) props[n] = v; }
+        record(TraceKind::PlayerAppeared, name, Glib::Variant<std::map<Glib::ustring, Glib::VariantBase>>::create(props));
+    }
+    Glib::VariantBase v; proxy->get_cached_property(v, "Position"); if (v) unbox(v, p.position);
+    proxy->get_cached_property(v, "Rate"); if (v) unbox(v, p.rate);
+    proxy->get_cached_property(v, "PlaybackStatus"); p.playing = is_playing(v); p.position_time = g_get_monotonic_time();
+    proxy->get_cached_property(v, "Metadata"); p.track = track_key(v);
+    proxy->signal_properties_changed().connect(sigc::bind(sigc::mem_fun(*this, &MediaMonitor::on_properties_changed), name));
+    proxy->signal_signal().connect(sigc::bind(sigc::mem_fun(*this, &MediaMonitor::on_player_signal), name));
+    refresh();
+} catch(...) { players.erase(name); } }
+
+// Re-anchors the extrapolated position whenever anything it depends on changes
+void MediaMonitor::on_properties_changed(const Gio::DBus::Proxy::MapChangedProperties& changed, const std::vector<Glib::ustring>&, Glib::ustring name) {
+    auto it = players.find(name); if (it == players.end()) return;
+    if (trace) record(TraceKind::PropertiesChanged, name, Glib::Variant<std::map<Glib::ustring, Glib::VariantBase>>::create(changed));
+    auto& p = it->second; gint64 now = g_get_monotonic_time();
+    auto status = changed.find("PlaybackStatus"), rate = changed.find("Rate"), pos = changed.find("Position"), meta = changed.find("Metadata");
+    if (status != changed.end() || rate != changed.end()) {
+        if (p.playing) p.position += (int64_t)((now - p.position_time) * p.rate);
+        p.position_time = now;
+        if (status != changed.end()) { p.playing = is_playing(status->second); if (name == toggle_target) toggle_confirmed = true; }
+        if (rate != changed.end()) unbox(rate->second, p.rate);
+    }
+    // Only a new track restarts at zero; any other Metadata update keeps extrapolating until the fetch lands
+    if (meta != changed.end()) if (auto key = track_key(meta->second); key != p.track) { p.track = key; p.position = 0; p.position_time = now; }
+    if (pos != changed.end() && unbox(pos->second, p.position)) p.position_time = now;
+    else if (status != changed.end() || meta != changed.end()) fetch_position(name);
+    refresh();
+}
+
+void MediaMonitor::on_player_signal(const Glib::ustring&, const Glib::ustring& signal, const Glib::VariantContainerBase& params, Glib::ustring name) { try {
+    if (signal != "Seeked") return;
+    auto it = players.find(name); if (it == players.end()) return;
+    Glib::Variant<gint64> v; params.get_child(v, 0); it->second.position = v.get(); it->second.position_time = g_get_monotonic_time();
+    record(TraceKind::Seeked, name, v);
+    refresh();
+} catch(...){} }
+
+// MPRIS does not signal Position, so it is fetched once to resync after track or status changes
+void MediaMonitor::fetch_position(const Glib::ustring& name) {
+    auto it = players.find(name); if (it == players.end() || !it->second.proxy) return;
+    it->second.proxy->call("org.freedesktop.DBus.Properties.Get", sigc::bind(sigc::mem_fun(*this, &MediaMonitor::on_position), name, g_get_monotonic_time()),
+        Glib::VariantContainerBase::create_tuple({Glib::Variant<Glib::ustring>::create("org.mpris.MediaPlayer2.Player"),Glib::Variant<Glib::ustring>::create("Position")}));
+}
+
+void MediaMonitor::on_position(Glib::RefPtr<Gio::AsyncResult>& r, Glib::ustring name, gint64 sent) { try {
+    auto it = players.find(name); if (it == players.end() || !it->second.proxy) return;
+    Glib::VariantBase v; it->second.proxy->call_finish(r).get_child(v, 0);
+    Stats::get().record(Stats::Metric::DbusRoundTrip, g_get_monotonic_time() - sent);
+    if (unbox(v, it->second.position)) { it->second.position_time = g_get_monotonic_time(); refresh(); }
+} catch(...){} }
+
+void MediaMonitor::record(TraceKind kind, const Glib::ustring& name, const Glib::VariantBase& arg) {
+    if (!trace) return;
+    std::vector<Glib::VariantBase> fields{Glib::Variant<Glib::ustring>::create(name)}; if (arg) fields.push_back(arg);
+    trace->write_variant(kind, Glib::VariantContainerBase::create_tuple(fields));
+}
+
+void MediaMonitor::refresh() {
+    MediaInfo play, pause; bool fp=false, hp=false;
+    for (auto& [name, p] : players) { if (!p.proxy) continue; auto i = get_info(name, p); if (i.is_playing) {play=i;fp=true;break;} else if (!hp&&!i.title.empty()) {pause=i;hp=true;} }
+    MediaInfo next = fp ? play : (hp ? pause : MediaInfo{});
+    bool meta = current.bus_name!=next.bus_name||current.title!=next.title||current.artist!=next.artist||current.album!=next.album||current.art_url!=next.art_url||current.length!=next.length;
+    bool status = current.is_playing!=next.is_playing||current.rate!=next.rate;
+    bool pos = meta||status||current.position!=next.position||current.position_time!=next.position_time;
+    current = next;
+    if (meta) metadata_sig.emit(current);
+    if (status) status_sig.emit(current);
+    if (pos) position_sig.emit(current);
+}
+
+MediaMonitor::MediaInfo MediaMonitor::get_info(const Glib::ustring& bus, const Player& p) const {
+    MediaInfo i; i.bus_name=bus; i.player_name=bus.substr(23); i.position=p.position; i.position_time=p.position_time; i.rate=p.rate; i.is_playing=p.playing;
+    i.title="Unknown"; i.artist="Unknown"; i.album=""; i.icon_name="multimedia-player";
+    Glib::VariantBase v; Glib::ustring s;
+    p.proxy->get_cached_property(v, "Metadata");
+    std::map<Glib::ustring,Glib::VariantBase> m; if (v && unbox(v, m)) {
+        if (m.count("xesam:title") && unbox(m["xesam:title"], s)) i.title = s;
+        if (m.count("xesam:album") && unbox(m["xesam:album"], s)) i.album = s;
+        if (m.count("xesam:artist")) { std::vector<Glib::ustring> a; if (unbox(m["xesam:artist"], a)) { if (!a.empty()) i.artist=a[0]; } else if (unbox(m["xesam:artist"], s)) i.artist=s; }
+        if (m.count("mpris:artUrl") && unbox(m["mpris:artUrl"], s)) i.art_url = s;
+        if (m.count("mpris:length")) unbox(m["mpris:length"], i.length);
+    }
+    if (i.player_name.find("spotify")!=std::string::npos) i.icon_name="spotify";
+    return i;
+}
@@ -0,0 +1,57 @@
+#include "novic/render.h"
+#include <algorithm>
+#include <cmath>
+
+void BarSprite::draw(const Cairo::RefPtr<Cairo::Context>& cr, const std::vector<float>& levels, double bw, double bs, double sx, double mh, double cy, int scale) {
+    double rad = bw / 2; int ch = std::ceil(rad);
+    if (!top || bw != cap_w || scale != cap_scale) {
+        cap_w = bw; cap_scale = scale;
+        top = Cairo::Surface::create(cr->get_target(), Cairo::CONTENT_ALPHA, std::ceil(bw), ch); auto t = Cairo::Context::create(top);
+        t->arc(rad, rad, rad, 0, 2 * M_PI); t->fill();
+        bottom = Cairo::Surface::create(cr->get_target(), Cairo::CONTENT_ALPHA, std::ceil(bw), ch); auto b = Cairo::Context::create(bottom);
+        b->arc(rad, ch - rad, rad, 0, 2 * M_PI); b->fill();
+    }
+    // Bar edges snap to whole device pixels (widget origins already are), so the caps are masked at integer offsets:
+    // pixman then takes its unfiltered fast path instead of resampling every cap, and the caps stay sharp
+    auto snap = [scale](double v) { return std::round(v * scale) / scale; };
+    cr->set_source_rgb(1, 1, 1);
+    for (size_t i = 0; i < levels.size(); i++) {
+        double bh = snap(bw + (mh - bw) * levels[i]), x = snap(sx + i * (bw + bs)), y = snap(cy - bh / 2);
+        cr->rectangle(x, y + rad, bw, bh - bw);
+    }
+    cr->fill();
+    for (size_t i = 0; i < levels.size(); i++) {
+        double bh = snap(bw + (mh - bw) * levels[i]), x = snap(sx + i * (bw + bs)), y = snap(cy - bh / 2);
+        cr->mask(top, x, y); cr->mask(bottom, x, snap(y + bh - ch));
+    }
+}
+
+void BackgroundCache::draw(const Cairo::RefPtr<Cairo::Context>& cr, int w, int h, int scale) {
+    if (!surface || w != sw || h != sh || scale != sscale) {
+        sw = w; sh = h; sscale = scale; double r = 25.0;
+        surface = Cairo::Surface::create(cr->get_target(), Cairo::CONTENT_COLOR_ALPHA, w, h); auto bg = Cairo::Context::create(surface);
+        bg->move_to(0, 0); bg->line_to(w, 0); bg->line_to(w, h - r);
+        bg->arc(w - r, h - r, r, 0, M_PI / 2); bg->arc(r, h - r, r, M_PI / 2, M_PI); bg->close_path();
+        bg->set_source_rgba(0.043, 0.047, 0.047, 0.98); bg->fill();
+    }
+    cr->set_source(surface, 0, 0); cr->paint();
+}
+
+void draw_collapsed_bars(const Cairo::RefPtr<Cairo::Context>& cr, BarSprite& sprite, const std::vector<float>& levels, double w, double h, int scale) {
+    int n = levels.size(); double bw = 3, bs = 3, tw = n * bw + (n - 1) * bs;
+    sprite.draw(cr, levels, bw, bs, w - tw - 4, h * 0.9, h / 2, scale);
+}
+
+void draw_expanded_bars(const Cairo::RefPtr<Cairo::Context>& cr, BarSprite& sprite, const std::vector<float>& levels, double w, double h, int scale) {
+    int n = levels.size(); double bw = 4, bs = 4, tw = n * bw + (n - 1) * bs;
+    sprite.draw(cr, levels, bw, bs, (w - tw) / 2, h * 0.85, h / 2, scale);
+}
+
+void draw_progress(const Cairo::RefPtr<Cairo::Context>& cr, double w, double h, double progress) {
+    progress = std::clamp(progress, 0.0, 1.0);
+    cr->arc(h/2, h/2, h/2, M_PI/2, 3*M_PI/2); cr->arc(w-h/2, h/2, h/2, 3*M_PI/2, M_PI/2); cr->close_path();
+    cr->set_source_rgb(0.2, 0.2, 0.2); cr->fill();
+    double pw = std::max(h, w * progress);
+    cr->arc(h/2, h/2, h/2, M_PI/2, 3*M_PI/2); cr->arc(pw-h/2, h/2, h/2, 3*M_PI/2, M_PI/2); cr->close_path();
+    cr->set_source_rgb(0.5, 0.5, 0.5); cr->fill();
+}
@@ -0,0 +1,106 @@
+#include "novic/spectrum_analyzer.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#if defined(__SSE2__) || defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+namespace {
+
+void mul(const float* a, const float* b, float* out, size_t n) {
+    size_t i = 0;
+#if defined(__AVX2__)
+    for (; i < (n & ~size_t(7)); i += 8) _mm256_storeu_ps(out + i, _mm256_mul_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i)));
+#elif defined(__SSE2__)
+    for (; i < (n & ~size_t(3)); i += 4) _mm_storeu_ps(out + i, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+#endif
+    for (; i < n; i++) out[i] = a[i] * b[i];
+}
+
+void magnitude(const float* r, const float* m, float* out, size_t n, float scale) {
+    size_t i = 0;
+#if defined(__AVX2__)
+    __m256 s = _mm256_set1_ps(scale);
+    for (; i < (n & ~size_t(7)); i += 8) { __m256 a = _mm256_loadu_ps(r + i), b = _mm256_loadu_ps(m + i);
+        _mm256_storeu_ps(out + i, _mm256_mul_ps(_mm256_add_ps(_mm256_mul_ps(a, a), _mm256_mul_ps(b, b)), s)); }
+#elif defined(__SSE2__)
+    __m128 s = _mm_set1_ps(scale);
+    for (; i < (n & ~size_t(3)); i += 4) { __m128 a = _mm_loadu_ps(r + i), b = _mm_loadu_ps(m + i);
+        _mm_storeu_ps(out + i, _mm_mul_ps(_mm_add_ps(_mm_mul_ps(a, a), _mm_mul_ps(b, b)), s)); }
+#endif
+    for (; i < n; i++) out[i] = (r[i] * r[i] + m[i] * m[i]) * scale;
+}
+
+float range_max(const float* p, size_t n) {
+    size_t i = 0; float best = 0.0f;
+#if defined(__AVX2__) || defined(__SSE2__)
+    __m128 acc = _mm_setzero_ps();
+#if defined(__AVX2__)
+    __m256 acc8 = _mm256_setzero_ps();
+    for (; i < (n & ~size_t(7)); i += 8) acc8 = _mm256_max_ps(acc8, _mm256_loadu_ps(p + i));
+    acc = _mm_max_ps(_mm256_castps256_ps128(acc8), _mm256_extractf128_ps(acc8, 1));
+#endif
+    for (; i < (n & ~size_t(3)); i += 4) acc = _mm_max_ps(acc, _mm_loadu_ps(p + i));
+    acc = _mm_max_ps(acc, _mm_movehl_ps(acc, acc)); acc = _mm_max_ss(acc, _mm_shuffle_ps(acc, acc, 1));
+    best = _mm_cvtss_f32(acc);
+#endif
+    for (; i < n; i++) best = std::max(best, p[i]);
+    return best;
+}
+
+}
+
+void SpectrumAnalyzer::configure(int bars, float rate) {
+    constexpr int M = FFT_SIZE / 2;
+    bars = std::clamp(bars, 1, MAX_BARS);
+    history.assign(FFT_SIZE, 0.0f); frame.assign(FFT_SIZE, 0.0f); window.resize(FFT_SIZE);
+    re.assign(M, 0.0f); im.assign(M, 0.0f); xre.assign(M, 0.0f); xim.assign(M, 0.0f); power.assign(M, 0.0f);
+    tw_re.resize(M / 2); tw_im.resize(M / 2); post_re.resize(M); post_im.resize(M); bitrev.resize(M);
+    for (int n = 0; n < FFT_SIZE; n++) window[n] = 0.5f - 0.5f * std::cos(2 * M_PI * n / (FFT_SIZE - 1));
+    for (int k = 0; k < M / 2; k++) { tw_re[k] = std::cos(2 * M_PI * k / M); tw_im[k] = -std::sin(2 * M_PI * k / M); }
+    for (int k = 0; k < M; k++) { post_re[k] = std::cos(2 * M_PI * k / FFT_SIZE); post_im[k] = -std::sin(2 * M_PI * k / FFT_SIZE); }
+    int bits = 0; while ((1 << bits) < M) bits++;
+    for (int k = 0; k < M; k++) { int r = 0; for (int b = 0; b < bits; b++) if (k & (1 << b)) r |= 1 << (bits - 1 - b); bitrev[k] = r; }
+    // Log-spaced band edges in FFT bins, each band at least one bin wide
+    double lo = 50.0, hi = std::min(16000.0, rate * 0.45);
+    edges.resize(bars + 1); edges[0] = std::max(1, (int)std::lround(lo * FFT_SIZE / rate));
+    for (int b = 1; b <= bars; b++) {
+        int bin = (int)std::lround(lo * std::pow(hi / lo, (double)b / bars) * FFT_SIZE / rate);
+        edges[b] = std::min(M, std::max(edges[b - 1] + 1, bin));
+    }
+}
+
+void SpectrumAnalyzer::push(const float* samples, size_t frames, int channels) {
+    if (frames >= (size_t)FFT_SIZE) { samples += (frames - FFT_SIZE) * channels; frames = FFT_SIZE; }
+    std::memmove(history.data(), history.data() + frames, (FFT_SIZE - frames) * sizeof(float));
+    float* dst = history.data() + FFT_SIZE - frames, scale = 1.0f / channels;
+    for (size_t i = 0; i < frames; i++) { float s = 0; for (int c = 0; c < channels; c++) s += samples[i * channels + c]; dst[i] = s * scale; }
+}
+
+void SpectrumAnalyzer::analyze(float* out) {
+    constexpr int M = FFT_SIZE / 2;
+    mul(history.data(), window.data(), frame.data(), FFT_SIZE);
+    // Real FFT of N samples as an N/2-point complex FFT over (even, odd) pairs
+    for (int k = 0; k < M; k++) { re[bitrev[k]] = frame[2 * k]; im[bitrev[k]] = frame[2 * k + 1]; }
+    for (int size = 2; size <= M; size *= 2) {
+        int half = size / 2, step = M / size;
+        for (int i = 0; i < M; i += size) for (int j = 0; j < half; j++) {
+            float wr = tw_re[j * step], wi = tw_im[j * step]; int a = i + j, b = a + half;
+            float tr = re[b] * wr - im[b] * wi, ti = re[b] * wi + im[b] * wr;
+            re[b] = re[a] - tr; im[b] = im[a] - ti; re[a] += tr; im[a] += ti;
+        }
+    }
+    for (int k = 0; k < M; k++) {
+        int c = (M - k) & (M - 1);
+        float er = 0.5f * (re[k] + re[c]), ei = 0.5f * (im[k] - im[c]);
+        float orr = 0.5f * (im[k] + im[c]), oi = -0.5f * (re[k] - re[c]);
+        xre[k] = er + orr * post_re[k] - oi * post_im[k]; xim[k] = ei + orr * post_im[k] + oi * post_re[k];
+    }
+    // Hann coherent gain is 0.5, so a full-scale sine peaks at |X| = N/4
+    magnitude(xre.data(), xim.data(), power.data(), M, 16.0f / ((float)FFT_SIZE * FFT_SIZE));
+    for (int b = 0; b < bar_count(); b++) {
+        float db = 10.0f * std::log10(range_max(power.data() + edges[b], edges[b + 1] - edges[b]) + 1e-12f);
+        out[b] = std::clamp((db - FLOOR_DB) / -FLOOR_DB, 0.0f, 1.0f);
+    }
+}
@@ -0,0 +1,115 @@
+#include "novic/stats.h"
+#include <algorithm>
+#include <cstdio>
+#include <map>
+
+namespace {
+
+constexpr const char* STATS_XML =
+    "<node><interface name='org.novic.Stats'>"
+    "<method name='GetHistograms'><arg name='histograms' type='a(stttttt)' direction='out'/></method>"
+    "<method name='GetCounters'><arg name='counters' type='a{st}' direction='out'/></method>"
+    "<method name='Reset'/>"
+    "</interface></node>";
+
+int bucket_of(int64_t us) { return us <= 0 ? 0 : std::min(Histogram::BUCKETS - 1, 64 - __builtin_clzll((uint64_t)us)); }
+
+}
+
+void Histogram::record(int64_t us) {
+    if (us < 0) us = 0;
+    buckets[bucket_of(us)].fetch_add(1, std::memory_order_relaxed);
+    count.fetch_add(1, std::memory_order_relaxed); total.fetch_add(us, std::memory_order_relaxed);
+    uint64_t m = max.load(std::memory_order_relaxed);
+    while ((uint64_t)us > m && !max.compare_exchange_weak(m, us, std::memory_order_relaxed)) {}
+}
+
+Histogram::Summary Histogram::summary() const {
+    Summary s; s.count = count.load(std::memory_order_relaxed); s.total_us = total.load(std::memory_order_relaxed); s.max_us = max.load(std::memory_order_relaxed);
+    uint64_t seen = 0, n = 0; for (auto& b : buckets) n += b.load(std::memory_order_relaxed);
+    std::pair<double, uint64_t*> targets[] = {{0.5, &s.p50_us}, {0.95, &s.p95_us}, {0.99, &s.p99_us}}; size_t t = 0;
+    for (int i = 0; i < BUCKETS && t < 3 && n; i++) {
+        seen += buckets[i].load(std::memory_order_relaxed);
+        for (; t < 3 && seen >= targets[t].first * n; t++) *targets[t].second = std::min<uint64_t>(i ? (1ull << i) - 1 : 0, s.max_us);
+    }
+    return s;
+}
+
+void Histogram::reset() {
+    for (auto& b : buckets) b.store(0, std::memory_order_relaxed);
+    count.store(0, std::memory_order_relaxed); total.store(0, std::memory_order_relaxed); max.store(0, std::memory_order_relaxed);
+}
+
+Stats& Stats::get() { static Stats s; return s; }
+
+const char* Stats::name(Metric m) {
+    switch (m) {
+        case Metric::Update: return "frame.update";
+        case Metric::DrawWindow: return "draw.window";
+        case Metric::DrawViz: return "draw.visualizer";
+        case Metric::DrawExpandedViz: return "draw.expanded_visualizer";
+        case Metric::DrawAlbumArt: return "draw.album_art";
+        case Metric::DrawProgress: return "draw.progress";
+        case Metric::ReadCallback: return "audio.read_cb";
+        case Metric::AudioToScreen: return "audio.to_screen";
+        case Metric::DbusRoundTrip: return "dbus.round_trip";
+        case Metric::ArtLoad: return "art.load";
+        case Metric::MainLoopStall: return "mainloop.stall";
+        default: return "?";
+    }
+}
+
+const char* Stats::name(Counter c) {
+    switch (c) {
+        case Counter::ArtMemoryHit: return "art.memory_hit";
+        case Counter::ArtDiskHit: return "art.disk_hit";
+        case Counter::ArtLoaded: return "art.loaded";
+        case Counter::ArtFailed: return "art.failed";
+        case Counter::TierChange: return "governor.tier_change";
+        default: return "?";
+    }
+}
+
+void Stats::reset() {
+    for (auto& h : histograms) h.reset();
+    for (auto& c : counters) c.store(0, std::memory_order_relaxed);
+}
+
+std::string Stats::format() const {
+    std::string out; char line[160];
+    std::snprintf(line, sizeof(line), "%-26s %10s %10s %10s %10s %10s %10s\n", "metric (us)", "count", "mean", "p50", "p95", "p99", "max"); out += line;
+    for (size_t i = 0; i < histograms.size(); i++) {
+        auto s = histograms[i].summary(); if (!s.count) continue;
+        std::snprintf(line, sizeof(line), "%-26s %10llu %10llu %10llu %10llu %10llu %10llu\n", name((Metric)i), (unsigned long long)s.count,
+            (unsigned long long)(s.total_us / s.count), (unsigned long long)s.p50_us, (unsigned long long)s.p95_us, (unsigned long long)s.p99_us, (unsigned long long)s.max_us);
+        out += line;
+    }
+    for (size_t i = 0; i < counters.size(); i++) { std::snprintf(line, sizeof(line), "%-26s %10llu\n", name((Counter)i), (unsigned long long)counter((Counter)i)); out += line; }
+    return out;
+}
+
+StatsService::StatsService(const Glib::RefPtr<Gio::DBus::Connection>& conn) : conn(conn), vtable(sigc::mem_fun(*this, &StatsService::on_method_call)) {
+    try { registration = conn->register_object("/org/novic/Stats", Gio::DBus::NodeInfo::create_for_xml(STATS_XML)->lookup_interface("org.novic.Stats"), vtable); } catch(...) {}
+}
+
+StatsService::~StatsService() { if (registration) conn->unregister_object(registration); }
+
+void StatsService::on_method_call(const Glib::RefPtr<Gio::DBus::Connection>&, const Glib::ustring&, const Glib::ustring&, const Glib::ustring&,
+                                  const Glib::ustring& method, const Glib::VariantContainerBase&, const Glib::RefPtr<Gio::DBus::MethodInvocation>& invocation) {
+    auto& stats = Stats::get();
+    if (method == "GetHistograms") {
+        GVariantBuilder b; g_variant_builder_init(&b, G_VARIANT_TYPE("a(stttttt)"));
+        for (size_t i = 0; i < (size_t)Stats::Metric::Count; i++) {
+            auto s = stats.histogram((Stats::Metric)i).summary();
+            g_variant_builder_add(&b, "(stttttt)", Stats::name((Stats::Metric)i), (guint64)s.count, (guint64)s.total_us,
+                (guint64)s.p50_us, (guint64)s.p95_us, (guint64)s.p99_us, (guint64)s.max_us);
+        }
+        invocation->return_value(Glib::VariantContainerBase(g_variant_new("(a(stttttt))", &b)));
+    } else if (method == "GetCounters") {
+        std::map<Glib::ustring, guint64> m;
+        for (size_t i = 0; i < (size_t)Stats::Counter::Count; i++) m[Stats::name((Stats::Counter)i)] = stats.counter((Stats::Counter)i);
+        invocation->return_value(Glib::VariantContainerBase::create_tuple(Glib::Variant<std::map<Glib::ustring, guint64>>::create(m)));
+    } else {
+        stats.reset(); invocation->return_value(Glib::VariantContainerBase());
+    }
+}
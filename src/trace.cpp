@@ -0,0 +1,74 @@
+#include "novic/trace.h"
+#include <cstring>
+
+namespace {
+
+constexpr char MAGIC[4] = {'N', 'V', 'T', 'R'};
+constexpr uint32_t VERSION = 1;
+
+const char* variant_type(TraceKind kind) {
+    switch (kind) {
+        case TraceKind::PlayerAppeared: case TraceKind::PropertiesChanged: return "(sa{sv})";
+        case TraceKind::PlayerVanished: return "(s)";
+        case TraceKind::Seeked: return "(sx)";
+        default: return nullptr;
+    }
+}
+
+}
+
+Glib::VariantContainerBase TraceRecord::variant() const {
+    auto* type = variant_type(kind); if (!type) return {};
+    GBytes* bytes = g_bytes_new(data.data(), data.size());
+    GVariant* v = g_variant_new_from_bytes(G_VARIANT_TYPE(type), bytes, FALSE);
+    g_bytes_unref(bytes);
+    return Glib::VariantContainerBase(v);
+}
+
+uint32_t TraceRecord::pcm_rate() const { uint32_t r = 0; if (data.size() >= 8) std::memcpy(&r, data.data(), 4); return r; }
+uint32_t TraceRecord::pcm_channels() const { uint32_t c = 0; if (data.size() >= 8) std::memcpy(&c, data.data() + 4, 4); return c; }
+const float* TraceRecord::pcm_samples() const { return reinterpret_cast<const float*>(data.data() + 8); }
+size_t TraceRecord::pcm_frames() const { auto c = pcm_channels(); return c && data.size() > 8 ? (data.size() - 8) / (sizeof(float) * c) : 0; }
+
+TraceWriter::TraceWriter(const std::string& path) : file(std::fopen(path.c_str(), "wb")), start(g_get_monotonic_time()) {
+    if (!file) return;
+    std::fwrite(MAGIC, 1, sizeof(MAGIC), file); std::fwrite(&VERSION, sizeof(VERSION), 1, file);
+}
+
+TraceWriter::~TraceWriter() { if (file) std::fclose(file); }
+
+void TraceWriter::write_variant(TraceKind kind, const Glib::VariantContainerBase& v) {
+    if (!file || !v) return;
+    write(kind, nullptr, 0, v.get_data(), v.get_size());
+}
+
+void TraceWriter::write_pcm(uint32_t rate, uint32_t channels, const float* samples, size_t frames) {
+    if (!file) return;
+    uint32_t head[2] = {rate, channels};
+    write(TraceKind::Pcm, head, sizeof(head), samples, frames * channels * sizeof(float));
+}
+
+void TraceWriter::write(TraceKind kind, const void* head, size_t head_size, const void* body, size_t body_size) {
+    int64_t t = g_get_monotonic_time() - start; uint32_t size = head_size + body_size; uint8_t k = (uint8_t)kind;
+    std::lock_guard<std::mutex> l(mtx);
+    std::fwrite(&k, 1, 1, file); std::fwrite(&t, sizeof(t), 1, file); std::fwrite(&size, sizeof(size), 1, file);
+    if (head_size) std::fwrite(head, 1, head_size, file);
+    if (body_size) std::fwrite(body, 1, body_size, file);
+}
+
+bool read_trace(const std::string& path, std::vector<TraceRecord>& out) {
+    std::FILE* f = std::fopen(path.c_str(), "rb"); if (!f) return false;
+    long length = std::fseek(f, 0, SEEK_END) == 0 ? std::ftell(f) : -1; std::rewind(f);
+    char magic[4]; uint32_t version = 0;
+    bool ok = length >= 0 && std::fread(magic, 1, 4, f) == 4 && std::memcmp(magic, MAGIC, 4) == 0 && std::fread(&version, sizeof(version), 1, f) == 1 && version == VERSION;
+    while (ok) {
+        uint8_t k; TraceRecord r; uint32_t size;
+        if (std::fread(&k, 1, 1, f) != 1 || std::fread(&r.time, sizeof(r.time), 1, f) != 1 || std::fread(&size, sizeof(size), 1, f) != 1) break;
+        // A corrupt or truncated size ends the trace instead of allocating whatever it claims
+        if (long pos = std::ftell(f); pos < 0 || size > (unsigned long)(length - pos)) break;
+        r.kind = (TraceKind)k; r.data.resize(size);
+        if (size && std::fread(r.data.data(), 1, size, f) != size) break;
+        out.push_back(std::move(r));
+    }
+    std::fclose(f); return ok;
+}